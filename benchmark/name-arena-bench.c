@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/* Microbenchmark of the component compare kernel against memcmp.
+ *
+ * Compares 256 L1-resident pairs of each block length, equal and differing
+ * at a random byte, and prints ns per compare. Build with the Makefile of
+ * this directory, with and without -mavx2.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+// The kernel is static, so it is compiled into this program
+#include "../forwarder/name-arena.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define PAIR_COUNT 256
+#define ROUNDS 200000
+
+static uint8_t lhs[PAIR_COUNT][NDN_NAME_COMPONENT_BLOCK_SIZE];
+static uint8_t rhs[PAIR_COUNT][NDN_NAME_COMPONENT_BLOCK_SIZE];
+static volatile int sink;
+
+static double
+now_ns(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static __attribute__((noinline)) double
+run_memcmp(size_t len)
+{
+  int sum = 0;
+  double start = now_ns();
+  for (int r = 0; r < ROUNDS; r ++) {
+    for (int i = 0; i < PAIR_COUNT; i ++) {
+      sum += memcmp(lhs[i], rhs[i], len);
+    }
+  }
+  sink = sum;
+  return (now_ns() - start) / ROUNDS / PAIR_COUNT;
+}
+
+static __attribute__((noinline)) double
+run_kernel(size_t len)
+{
+  int sum = 0;
+  double start = now_ns();
+  for (int r = 0; r < ROUNDS; r ++) {
+    for (int i = 0; i < PAIR_COUNT; i ++) {
+      sum += name_arena_memcmp(lhs[i], rhs[i], len);
+    }
+  }
+  sink = sum;
+  return (now_ns() - start) / ROUNDS / PAIR_COUNT;
+}
+
+static void
+fill(size_t len, bool differ)
+{
+  srand(2);
+  for (int i = 0; i < PAIR_COUNT; i ++) {
+    for (size_t j = 0; j < NDN_NAME_COMPONENT_BLOCK_SIZE; j ++) {
+      lhs[i][j] = rhs[i][j] = 'a' + j % 26;
+    }
+    if (differ) {
+      lhs[i][rand() % len] ^= 1;
+    }
+  }
+}
+
+int
+main(void)
+{
+  static const size_t lengths[] = {4, 8, 12, 16, 18, 24, 28, 30, 32, 34, 38};
+  const char* kernel =
+#if defined(__AVX2__)
+    "avx2";
+#elif defined(NAME_ARENA_VECTOR)
+    "sse2/neon";
+#else
+    "memcmp";
+#endif
+
+  printf("kernel: %s, ns per compare (memcmp -> kernel)\n", kernel);
+  printf("len  equal          differing\n");
+  for (size_t k = 0; k < sizeof(lengths) / sizeof(lengths[0]); k ++) {
+    size_t len = lengths[k];
+    double eq_m, eq_k, ne_m, ne_k;
+    fill(len, false);
+    run_memcmp(len);
+    run_kernel(len);
+    eq_m = run_memcmp(len);
+    eq_k = run_kernel(len);
+    fill(len, true);
+    ne_m = run_memcmp(len);
+    ne_k = run_kernel(len);
+    printf("%3zu  %5.2f -> %5.2f  %5.2f -> %5.2f\n", len, eq_m, eq_k, ne_m, ne_k);
+  }
+  return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/* Workload benchmark of the NameTree backend selected at compile time.
+ *
+ * Replays two name sets:
+ *   wide  /deviceN/itemM, with 500 siblings under the root;
+ *   deep  six levels of fan-out 4.
+ * For each, prints ns per operation of inserting all names, finding names
+ * drawn from a Zipf(1) or uniform popularity, longest prefix matching longer
+ * names drawn from Zipf(1), and churn, i.e. releasing a name and inserting it
+ * again. Also prints the memory reserved per entry, including the arena.
+ * The Makefile of this directory builds one program per backend.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include "forwarder/name-tree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CAPACITY 8192
+#define NAME_COUNT 4000
+#define DRAW_COUNT (1 << 16)
+#define ROUNDS 20
+
+static void* memory[NDN_NAMETREE_RESERVE_SIZE(CAPACITY) / sizeof(void*) + 1];
+static uint8_t name_bufs[NAME_COUNT][160];
+static uint8_t longer_bufs[NAME_COUNT][200];
+static ndn_parsed_name_t names[NAME_COUNT];
+static ndn_parsed_name_t longer_names[NAME_COUNT];
+static double zipf_cdf[NAME_COUNT];
+static int zipf_draws[DRAW_COUNT];
+static volatile long sink;
+
+#if defined(NDN_NAMETREE_HASH)
+#define BACKEND "hash"
+#elif defined(NDN_NAMETREE_SPLAY)
+#define BACKEND "splay"
+#else
+#define BACKEND "trie"
+#endif
+
+static double
+now_ns(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void
+make_name(uint8_t* buf, bool deep, int id, int extra, ndn_parsed_name_t* parsed)
+{
+  uint8_t* ptr = buf + 2;
+  int levels = deep ? 6 : 2;
+  int value, len;
+
+  for (int l = 0; l < levels; l ++) {
+    if (deep) {
+      value = (l == levels - 1) ? id : (id >> (l * 2)) & 3;
+    } else {
+      value = (l == 0) ? id % 500 : id / 500;
+    }
+    len = sprintf((char*)ptr + 2, "%s%d", deep ? "lvl" : (l == 0 ? "device" : "item"), value);
+    ptr[0] = 8;
+    ptr[1] = len;
+    ptr += len + 2;
+  }
+  for (int e = 0; e < extra; e ++) {
+    memcpy(ptr, "\x08\x04xtra", 6);
+    ptr += 6;
+  }
+  buf[0] = 7;
+  buf[1] = ptr - buf - 2;
+  if (ndn_parsed_name_init(parsed, buf, ptr - buf) != 0) {
+    fprintf(stderr, "cannot parse name %d\n", id);
+    exit(1);
+  }
+}
+
+// Popularity rank i has weight 1 / (i + 1); ranks are scattered over the names
+static void
+draw_zipf(void)
+{
+  double sum = 0;
+  int lo, hi, mid;
+
+  for (int i = 0; i < NAME_COUNT; i ++) {
+    sum += 1.0 / (i + 1);
+    zipf_cdf[i] = sum;
+  }
+  srand(5);
+  for (int k = 0; k < DRAW_COUNT; k ++) {
+    double u = (double)rand() / RAND_MAX * sum;
+    lo = 0;
+    hi = NAME_COUNT - 1;
+    while (lo < hi) {
+      mid = (lo + hi) / 2;
+      if (zipf_cdf[mid] < u) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    zipf_draws[k] = (int)((long)lo * 7919 % NAME_COUNT);
+  }
+}
+
+static void
+run(bool deep)
+{
+  ndn_nametree_t* tree = (ndn_nametree_t*)memory;
+  nametree_entry_t* node;
+  double start, insert, find_zipf, find_uniform, lpm_zipf, churn;
+  long hits = 0;
+  bool exact;
+
+  ndn_nametree_init(memory, CAPACITY);
+  for (int i = 0; i < NAME_COUNT; i ++) {
+    make_name(name_bufs[i], deep, i, 0, &names[i]);
+    make_name(longer_bufs[i], deep, i, 2, &longer_names[i]);
+  }
+
+  start = now_ns();
+  for (int i = 0; i < NAME_COUNT; i ++) {
+    node = ndn_nametree_find_or_insert(tree, &names[i]);
+    if (node == NULL) {
+      fprintf(stderr, "NameTree full after %d names\n", i);
+      exit(1);
+    }
+    ndn_nametree_ref(tree, node);
+  }
+  insert = (now_ns() - start) / NAME_COUNT;
+
+  start = now_ns();
+  for (int r = 0; r < ROUNDS; r ++) {
+    for (int k = 0; k < DRAW_COUNT; k ++) {
+      hits += (ndn_nametree_find(tree, &names[zipf_draws[k]]) != NULL);
+    }
+  }
+  find_zipf = (now_ns() - start) / ROUNDS / DRAW_COUNT;
+
+  start = now_ns();
+  for (int r = 0; r < ROUNDS; r ++) {
+    for (int k = 0; k < DRAW_COUNT; k ++) {
+      hits += (ndn_nametree_find(tree, &names[(k * 2654435761u) % NAME_COUNT]) != NULL);
+    }
+  }
+  find_uniform = (now_ns() - start) / ROUNDS / DRAW_COUNT;
+
+  start = now_ns();
+  for (int r = 0; r < ROUNDS; r ++) {
+    for (int k = 0; k < DRAW_COUNT; k ++) {
+      hits += (ndn_nametree_longest_prefix(tree, &longer_names[zipf_draws[k]], &exact) != NULL);
+    }
+  }
+  lpm_zipf = (now_ns() - start) / ROUNDS / DRAW_COUNT;
+
+  start = now_ns();
+  for (int k = 0; k < DRAW_COUNT; k ++) {
+    int i = (int)((k * 40503u) % NAME_COUNT);
+    ndn_nametree_unref(tree, ndn_nametree_find(tree, &names[i]));
+    ndn_nametree_ref(tree, ndn_nametree_find_or_insert(tree, &names[i]));
+  }
+  churn = (now_ns() - start) / DRAW_COUNT;
+
+  sink = hits;
+  if (hits != 3L * ROUNDS * DRAW_COUNT) {
+    fprintf(stderr, "%s: %ld lookups missed\n", deep ? "deep" : "wide", 3L * ROUNDS * DRAW_COUNT - hits);
+  }
+  printf("%-5s %-5s %7.0f %11.0f %13.0f %10.0f %7.0f\n", BACKEND, deep ? "deep" : "wide",
+         insert, find_zipf, find_uniform, lpm_zipf, churn);
+}
+
+int
+main(void)
+{
+  draw_zipf();
+  printf("%d names, ns/op; churn is one release and reinsert\n", NAME_COUNT);
+  printf("              insert  find(Zipf)  find(uniform)  LPM(Zipf)   churn\n");
+  run(false);
+  run(true);
+  printf("%-5s memory %.1f B/entry\n", BACKEND,
+         (double)NDN_NAMETREE_RESERVE_SIZE(CAPACITY) / CAPACITY);
+  return 0;
+}
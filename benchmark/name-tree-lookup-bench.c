@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/* Lookup benchmark of a NameTree larger than the L1 cache.
+ *
+ * Fills about 11k nodes of /sensorNNN/roomNNN/seqNNNN, whose siblings share
+ * their type, length and leading bytes, and times ndn_nametree_find on
+ * uniformly drawn existing names. The number of sensors sets the fan-out
+ * at the first level. Prints the best ns per lookup of several rounds.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include "forwarder/name-tree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CAPACITY 12000
+#define ROOMS 8
+#define QUERY_COUNT 4096
+#define ROUNDS 7
+#define REPEATS 200
+
+static void* memory[NDN_NAMETREE_RESERVE_SIZE(CAPACITY) / sizeof(void*) + 1];
+static uint8_t names[QUERY_COUNT][64];
+static ndn_parsed_name_t queries[QUERY_COUNT];
+static int inserted[CAPACITY][3];
+
+static double
+now_ns(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static size_t
+make_name(uint8_t* buf, int sensor, int room, int seq)
+{
+  int len = snprintf((char*)buf + 2, 62, "%c%csensor%03d%c%croom%03d%c%cseq%04d",
+                     8, 9, sensor, 8, 7, room, 8, 7, seq);
+  buf[0] = 7;
+  buf[1] = len;
+  return len + 2;
+}
+
+static void
+run(int sensors)
+{
+  ndn_nametree_t* tree = (ndn_nametree_t*)memory;
+  ndn_parsed_name_t parsed;
+  nametree_entry_t* node;
+  uint8_t buf[64];
+  int count = 0, per_room = CAPACITY / sensors / ROOMS - 2;
+  long found = 0;
+  double best = 1e30, start, elapsed;
+
+  ndn_nametree_init(memory, CAPACITY);
+  srand(3);
+  for (int s = 0; s < sensors; s ++) {
+    for (int r = 0; r < ROOMS; r ++) {
+      for (int q = 0; q < per_room && count < CAPACITY - 2 * sensors * ROOMS - 10; q ++) {
+        ndn_parsed_name_init(&parsed, buf, make_name(buf, s, r, q));
+        node = ndn_nametree_find_or_insert(tree, &parsed);
+        if (node == NULL) {
+          break;
+        }
+        ndn_nametree_ref(tree, node);
+        inserted[count][0] = s;
+        inserted[count][1] = r;
+        inserted[count][2] = q;
+        count ++;
+      }
+    }
+  }
+  for (int i = 0; i < QUERY_COUNT; i ++) {
+    int j = rand() % count;
+    size_t len = make_name(names[i], inserted[j][0], inserted[j][1], inserted[j][2]);
+    ndn_parsed_name_init(&queries[i], names[i], len);
+  }
+
+  for (int r = 0; r < ROUNDS; r ++) {
+    start = now_ns();
+    for (int k = 0; k < REPEATS; k ++) {
+      for (int i = 0; i < QUERY_COUNT; i ++) {
+        found += (ndn_nametree_find(tree, &queries[i]) != NULL);
+      }
+    }
+    elapsed = (now_ns() - start) / REPEATS / QUERY_COUNT;
+    if (elapsed < best) {
+      best = elapsed;
+    }
+  }
+  printf("%4d sensors, %5d names: %7.1f ns/lookup%s\n", sensors, count, best,
+         found == (long)ROUNDS * REPEATS * QUERY_COUNT ? "" : " (MISSED)");
+}
+
+int
+main(void)
+{
+  static const int fan_outs[] = {4, 16, 64, 256};
+
+  for (size_t i = 0; i < sizeof(fan_outs) / sizeof(fan_outs[0]); i ++) {
+    run(fan_outs[i]);
+  }
+  return 0;
+}
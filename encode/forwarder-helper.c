@@ -7,6 +7,8 @@
  */
 #include "forwarder-helper.h"
 #include "tlv.h"
+#include "encoder.h"
+#include "../ndn-enums.h"
 #include "../ndn-error-code.h"
 #include "../ndn-constants.h"
 #include <string.h>
@@ -87,7 +89,7 @@ tlv_get_uint(uint8_t* buf, size_t buflen)
 {
   uint64_t ret = 0;
   while(buflen --){
-    ret = (ret << (uint64_t)8) + buf[0];
+    ret = (ret << (uint64_t)8) + *(buf ++);
   }
   return ret;
 }
@@ -193,6 +195,95 @@ tlv_data_get_name(uint8_t* data,
   return NDN_SUCCESS;
 }
 
+int
+tlv_lp_get_fragment(uint8_t* packet,
+                    size_t buflen,
+                    bool* is_nack,
+                    uint32_t* reason,
+                    uint8_t** fragment,
+                    size_t* fragment_len)
+{
+  uint32_t real_type, real_len;
+  uint8_t *ptr, *nack_end;
+
+  ptr = tlv_get_type_length(packet, buflen, &real_type, &real_len);
+  if(ptr == NULL){
+    return NDN_OVERSIZE_VAR;
+  }
+  if(real_type != TLV_LpPacket){
+    return NDN_WRONG_TLV_TYPE;
+  }
+  if(real_len != buflen - (ptr - packet)){
+    return NDN_WRONG_TLV_LENGTH;
+  }
+
+  *is_nack = false;
+  *reason = NDN_NACK_REASON_NONE;
+  *fragment = NULL;
+  while(ptr < packet + buflen){
+    ptr = tlv_get_type_length(ptr, buflen - (ptr - packet), &real_type, &real_len);
+    if(ptr == NULL || real_len > buflen - (ptr - packet)){
+      return NDN_OVERSIZE_VAR;
+    }
+    if(real_type == TLV_LpNack){
+      *is_nack = true;
+      nack_end = ptr + real_len;
+      while(ptr < nack_end){
+        ptr = tlv_get_type_length(ptr, nack_end - ptr, &real_type, &real_len);
+        if(ptr == NULL || real_len > (size_t)(nack_end - ptr)){
+          return NDN_OVERSIZE_VAR;
+        }
+        if(real_type == TLV_LpNackReason){
+          *reason = (uint32_t)tlv_get_uint(ptr, real_len);
+        }
+        ptr += real_len;
+      }
+      continue;
+    }
+    if(real_type == TLV_LpFragment){
+      *fragment = ptr;
+      *fragment_len = real_len;
+    }
+    ptr += real_len;
+  }
+  if(*fragment == NULL){
+    return NDN_UNSUPPORTED_FORMAT;
+  }
+  return NDN_SUCCESS;
+}
+
+size_t
+tlv_make_nack(uint8_t* buf,
+              size_t buflen,
+              uint32_t reason,
+              const uint8_t* interest,
+              size_t interest_len)
+{
+  ndn_encoder_t encoder;
+  uint32_t reason_size, nack_size, fragment_size, packet_size;
+
+  reason_size = encoder_probe_block_size(TLV_LpNackReason, encoder_probe_uint_length(reason));
+  nack_size = encoder_probe_block_size(TLV_LpNack, reason_size);
+  fragment_size = encoder_probe_block_size(TLV_LpFragment, interest_len);
+  packet_size = encoder_probe_block_size(TLV_LpPacket, nack_size + fragment_size);
+  if(packet_size > buflen){
+    return 0;
+  }
+
+  encoder_init(&encoder, buf, packet_size);
+  encoder_append_type(&encoder, TLV_LpPacket);
+  encoder_append_length(&encoder, nack_size + fragment_size);
+  encoder_append_type(&encoder, TLV_LpNack);
+  encoder_append_length(&encoder, reason_size);
+  encoder_append_type(&encoder, TLV_LpNackReason);
+  encoder_append_length(&encoder, encoder_probe_uint_length(reason));
+  encoder_append_uint_value(&encoder, reason);
+  encoder_append_type(&encoder, TLV_LpFragment);
+  encoder_append_length(&encoder, interest_len);
+  encoder_append_raw_buffer_value(&encoder, interest, interest_len);
+  return encoder.offset;
+}
+
 uint8_t*
 tlv_interest_get_hoplimit_ptr(uint8_t* interest, size_t buflen){
   uint32_t real_type, real_len;
@@ -214,3 +305,41 @@ tlv_interest_get_hoplimit_ptr(uint8_t* interest, size_t buflen){
   }
   return NULL;
 }
+
+uint64_t
+tlv_data_get_freshness_period(uint8_t* data, size_t buflen){
+  uint32_t real_type, real_len;
+  uint8_t* ptr;
+  uint8_t* metainfo_end;
+
+  ptr = tlv_get_type_length(data, buflen, &real_type, &real_len);
+  if(ptr == NULL){
+    return 0;
+  }
+  while(ptr < data + buflen){
+    ptr = tlv_get_type_length(ptr, buflen - (ptr - data), &real_type, &real_len);
+    if(ptr == NULL || real_len > buflen - (ptr - data)){
+      return 0;
+    }
+    if(real_type == TLV_MetaInfo){
+      metainfo_end = ptr + real_len;
+      while(ptr < metainfo_end){
+        ptr = tlv_get_type_length(ptr, metainfo_end - ptr, &real_type, &real_len);
+        if(ptr == NULL || real_len > (size_t)(metainfo_end - ptr)){
+          return 0;
+        }
+        if(real_type == TLV_FreshnessPeriod){
+          // A NonNegativeInteger takes 1, 2, 4 or 8 bytes
+          if(real_len != 1 && real_len != 2 && real_len != 4 && real_len != 8){
+            return 0;
+          }
+          return tlv_get_uint(ptr, real_len);
+        }
+        ptr += real_len;
+      }
+      return 0;
+    }
+    ptr += real_len;
+  }
+  return 0;
+}
@@ -126,6 +126,56 @@ tlv_data_get_name(uint8_t* data,
 uint8_t*
 tlv_interest_get_hoplimit_ptr(uint8_t* interest, size_t buflen);
 
+/** Get the FreshnessPeriod of a Data packet.
+ *
+ * @param[in] data The Data packet.
+ * @param[in] buflen The length of @c data.
+ * @return The FreshnessPeriod in ms.
+ *         If @c data doesn't contain a valid FreshnessPeriod field, return 0.
+ * @pre #tlv_data_get_name should succeed for @c data.
+ */
+uint64_t
+tlv_data_get_freshness_period(uint8_t* data, size_t buflen);
+
+/** Get the fragment of an NDNLPv2 packet, and its Nack header if any.
+ *
+ * Other header fields are ignored.
+ * @param[in] packet The LpPacket.
+ * @param[in] buflen The length of @c packet.
+ * @param[out] is_nack Whether @c packet is a Nack.
+ * @param[out] reason The Nack reason, #NDN_NACK_REASON_NONE if not given.
+ * @param[out] fragment A pointer to the fragment, i.e. the Interest of a Nack.
+ * @param[out] fragment_len The length of @c fragment.
+ * @retval #NDN_SUCCESS The operation succeeds.
+ * @retval #NDN_OVERSIZE_VAR Either type of length in @c buf is truncated or malicious.
+ * @retval #NDN_WRONG_TLV_TYPE The type of @c buf is not #TLV_LpPacket.
+ * @retval #NDN_WRONG_TLV_LENGTH The length of @c buf is different from @c length.
+ * @retval #NDN_UNSUPPORTED_FORMAT @c packet has no fragment.
+ */
+int
+tlv_lp_get_fragment(uint8_t* packet,
+                    size_t buflen,
+                    bool* is_nack,
+                    uint32_t* reason,
+                    uint8_t** fragment,
+                    size_t* fragment_len);
+
+/** Encode an NDNLPv2 Nack of an Interest.
+ *
+ * @param[out] buf The buffer to hold the Nack.
+ * @param[in] buflen The size of @c buf.
+ * @param[in] reason The Nack reason.
+ * @param[in] interest The Interest rejected.
+ * @param[in] interest_len The length of @c interest.
+ * @return The length of the Nack. 0 if @c buf is too small.
+ */
+size_t
+tlv_make_nack(uint8_t* buf,
+              size_t buflen,
+              uint32_t reason,
+              const uint8_t* interest,
+              size_t interest_len);
+
 /** Decode an unsigned integer value.
  *
  * @param[in] buf Buffer pointing to the value, not including T and L.
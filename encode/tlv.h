@@ -18,6 +18,12 @@ enum {
   // packet types
   TLV_Interest = 5,
   TLV_Data = 6,
+  TLV_LpPacket = 100,
+
+  // NDNLPv2
+  TLV_LpFragment = 80,
+  TLV_LpNack = 800,
+  TLV_LpNackReason = 801,
 
   // common elements
   TLV_Name = 7,
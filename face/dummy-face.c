@@ -73,6 +73,7 @@ ndn_dummy_face_construct()
 
   face->intf.up = ndn_dummy_face_up;
   face->intf.send = ndn_dummy_face_send;
+  face->intf.send_buf = NULL;
   face->intf.down = ndn_dummy_face_down;
   face->intf.destroy = ndn_dummy_face_destroy;
   face->intf.face_id = NDN_INVALID_ID;
@@ -39,6 +39,18 @@ typedef void (*ndn_on_data_func)(const uint8_t* data, uint32_t data_size, void*
  */
 typedef void (*ndn_on_timeout_func)(void* userdata);
 
+/** The onNack callback function.
+ *
+ * @param[in] interest The encoded interest rejected by the network.
+ * @param[in] interest_size The length of the @c interest .
+ * @param[in] reason The Nack reason, e.g. #NDN_NACK_REASON_NO_ROUTE.
+ * @param[in] userdata [Optional] User defined data.
+ */
+typedef void (*ndn_on_nack_func)(const uint8_t* interest,
+                                 uint32_t interest_size,
+                                 uint32_t reason,
+                                 void* userdata);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "cs.h"
+#include "../ndn-error-code.h"
+#include <string.h>
+
+static inline void
+ndn_cs_entry_reset(ndn_cs_entry_t* self){
+  self->nametree_id = NDN_INVALID_ID;
+  self->stale_time = 0;
+  self->length = 0;
+  self->prev = NDN_INVALID_ID;
+}
+
+void
+ndn_cs_init(void* memory, ndn_table_id_t capacity, ndn_nametree_t* nametree){
+  ndn_table_id_t i;
+  ndn_cs_t* self = (ndn_cs_t*)memory;
+  self->capacity = capacity;
+  self->nametree = nametree;
+  self->lru_head = self->lru_tail = NDN_INVALID_ID;
+  // All free entries are linked by next
+  for(i = 0; i < capacity; i ++){
+    ndn_cs_entry_reset(&self->slots[i]);
+    self->slots[i].next = i + 1;
+  }
+  if(capacity > 0){
+    self->slots[capacity - 1].next = NDN_INVALID_ID;
+    self->free_head = 0;
+  }else{
+    self->free_head = NDN_INVALID_ID;
+  }
+}
+
+static void
+ndn_cs_lru_unlink(ndn_cs_t* self, ndn_table_id_t id){
+  ndn_cs_entry_t* entry = &self->slots[id];
+  if(entry->prev != NDN_INVALID_ID){
+    self->slots[entry->prev].next = entry->next;
+  }else{
+    self->lru_head = entry->next;
+  }
+  if(entry->next != NDN_INVALID_ID){
+    self->slots[entry->next].prev = entry->prev;
+  }else{
+    self->lru_tail = entry->prev;
+  }
+  entry->prev = entry->next = NDN_INVALID_ID;
+}
+
+static void
+ndn_cs_lru_push_front(ndn_cs_t* self, ndn_table_id_t id){
+  ndn_cs_entry_t* entry = &self->slots[id];
+  entry->prev = NDN_INVALID_ID;
+  entry->next = self->lru_head;
+  if(self->lru_head != NDN_INVALID_ID){
+    self->slots[self->lru_head].prev = id;
+  }else{
+    self->lru_tail = id;
+  }
+  self->lru_head = id;
+}
+
+void
+ndn_cs_remove_entry(ndn_cs_t* self, ndn_cs_entry_t* entry){
+  ndn_table_id_t id = entry - self->slots;
+  nametree_entry_t* node;
+  if(entry->nametree_id == NDN_INVALID_ID){
+    return;
+  }
+  node = ndn_nametree_at(self->nametree, entry->nametree_id);
+  node->cs_id = NDN_INVALID_ID;
+  ndn_nametree_unref(self->nametree, node);
+  ndn_cs_lru_unlink(self, id);
+  ndn_cs_entry_reset(entry);
+  entry->next = self->free_head;
+  self->free_head = id;
+}
+
+static ndn_table_id_t
+ndn_cs_add_new_entry(ndn_cs_t* self, ndn_table_id_t nametree_id){
+  ndn_table_id_t id = self->free_head;
+  if(id == NDN_INVALID_ID){
+    return NDN_INVALID_ID;
+  }
+  self->free_head = self->slots[id].next;
+  ndn_cs_entry_reset(&self->slots[id]);
+  self->slots[id].nametree_id = nametree_id;
+  ndn_cs_lru_push_front(self, id);
+  return id;
+}
+
+ndn_cs_entry_t*
+ndn_cs_insert(ndn_cs_t* self, const ndn_parsed_name_t* name, uint8_t* data, size_t length){
+  nametree_entry_t* node;
+  ndn_cs_entry_t* entry;
+
+  if(length > NDN_CS_DATA_BUFFER_SIZE){
+    return NULL;
+  }
+  node = ndn_nametree_find(self->nametree, name);
+  if(node == NULL || node->cs_id == NDN_INVALID_ID){
+    // Evict the least recently used one before touching NameTree,
+    // since the eviction may free nodes on the path of name
+    if(self->free_head == NDN_INVALID_ID && self->lru_tail != NDN_INVALID_ID){
+      ndn_cs_remove_entry(self, &self->slots[self->lru_tail]);
+    }
+    node = ndn_nametree_find_or_insert(self->nametree, name);
+    if(node == NULL){
+      return NULL;
+    }
+    node->cs_id = ndn_cs_add_new_entry(self, ndn_nametree_getid(self->nametree, node));
+    if(node->cs_id == NDN_INVALID_ID){
+      ndn_nametree_release(self->nametree, node);
+      return NULL;
+    }
+    ndn_nametree_ref(self->nametree, node);
+  }else{
+    ndn_cs_lru_unlink(self, node->cs_id);
+    ndn_cs_lru_push_front(self, node->cs_id);
+  }
+
+  entry = &self->slots[node->cs_id];
+  memcpy(entry->data, data, length);
+  entry->length = length;
+  entry->stale_time = ndn_time_now_ms() + tlv_data_get_freshness_period(data, length);
+  return entry;
+}
+
+static inline bool
+ndn_cs_entry_usable(ndn_cs_entry_t* entry, interest_options_t* options, ndn_time_ms_t now){
+  return !options->must_be_fresh || entry->stale_time > now;
+}
+
+/** The state of a CanBePrefix search below the Interest's node.
+ */
+typedef struct ndn_cs_search{
+  ndn_cs_t* self;
+  interest_options_t* options;
+  ndn_time_ms_t now;
+} ndn_cs_search_t;
+
+static bool
+ndn_cs_search_visit(void* ctx, nametree_entry_t* node){
+  ndn_cs_search_t* search = (ndn_cs_search_t*)ctx;
+  return node->cs_id != NDN_INVALID_ID &&
+         ndn_cs_entry_usable(&search->self->slots[node->cs_id], search->options, search->now);
+}
+
+ndn_cs_entry_t*
+ndn_cs_match(ndn_cs_t* self, const ndn_parsed_name_t* name, interest_options_t* options){
+  nametree_entry_t* node;
+  ndn_cs_entry_t* entry = NULL;
+  ndn_table_id_t id;
+  ndn_time_ms_t now = ndn_time_now_ms();
+  ndn_cs_search_t search;
+
+  node = ndn_nametree_find(self->nametree, name);
+  if(node != NULL && node->cs_id != NDN_INVALID_ID &&
+     ndn_cs_entry_usable(&self->slots[node->cs_id], options, now))
+  {
+    entry = &self->slots[node->cs_id];
+  }
+
+  // Data under the prefix are the nodes below the Interest's one
+  if(entry == NULL && node != NULL && options->can_be_prefix){
+    search.self = self;
+    search.options = options;
+    search.now = now;
+    node = ndn_nametree_search_subtree(self->nametree, node, ndn_cs_search_visit, &search);
+    if(node != NULL){
+      entry = &self->slots[node->cs_id];
+    }
+  }
+
+  if(entry != NULL){
+    id = entry - self->slots;
+    ndn_cs_lru_unlink(self, id);
+    ndn_cs_lru_push_front(self, id);
+  }
+  return entry;
+}
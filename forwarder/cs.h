@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef FORWARDER_CS_H_
+#define FORWARDER_CS_H_
+
+#include "../encode/forwarder-helper.h"
+#include "../util/uniform-time.h"
+#include "name-tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup NDNFwdCS CS
+ * @brief Content Store
+ * @ingroup NDNFwd
+ * @{
+ */
+
+/**
+ * CS entry.
+ */
+typedef struct ndn_cs_entry {
+  /** Timestamp when the Data becomes stale.
+   * Used to answer Interests with MustBeFresh.
+   */
+  ndn_time_ms_t stale_time;
+
+  /** The length of the cached Data.
+   */
+  uint32_t length;
+
+  /** Previous entry in the LRU list, i.e. the one used more recently.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t prev;
+
+  /** Next entry in the LRU list, i.e. the one used less recently.
+   * For a free entry, it is the next free entry.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t next;
+
+  /** NameTree entry's ID.
+   * #NDN_INVALID_ID if the entry is empty.
+   */
+  ndn_table_id_t nametree_id;
+
+  /** The encoded Data packet.
+   */
+  uint8_t data[NDN_CS_DATA_BUFFER_SIZE];
+} ndn_cs_entry_t;
+
+/**
+ * Content Store (CS).
+ *
+ * Entries are indexed by NameTree nodes and evicted in LRU order.
+ */
+typedef struct ndn_cs {
+  ndn_nametree_t* nametree;
+  ndn_table_id_t capacity;
+
+  /** The most recently used entry.
+   */
+  ndn_table_id_t lru_head;
+
+  /** The least recently used entry, evicted first.
+   */
+  ndn_table_id_t lru_tail;
+
+  /** The first free entry.
+   */
+  ndn_table_id_t free_head;
+
+  ndn_cs_entry_t slots[];
+} ndn_cs_t;
+
+#define NDN_CS_RESERVE_SIZE(entry_count) \
+  (sizeof(ndn_cs_t) + sizeof(ndn_cs_entry_t) * (entry_count))
+
+void
+ndn_cs_init(void* memory, ndn_table_id_t capacity, ndn_nametree_t* nametree);
+
+/** Cache a Data packet.
+ *
+ * An existing entry with the same name is replaced.
+ * The least recently used entry is evicted if CS is full.
+ * @param[in, out] self CS.
+ * @param[in] name The name of @c data.
+ * @param[in] data The Data packet.
+ * @param[in] length The length of @c data.
+ * @return The new entry. @c NULL if @c data is too large or NameTree is full.
+ */
+ndn_cs_entry_t*
+ndn_cs_insert(ndn_cs_t* self, const ndn_parsed_name_t* name, uint8_t* data, size_t length);
+
+/** Find a Data packet which can satisfy an Interest.
+ *
+ * The exact match is tried first. If @c options has CanBePrefix,
+ * cached Data under @c name are searched in the NameTree nodes below it.
+ * @param[in, out] self CS.
+ * @param[in] name The name of the Interest.
+ * @param[in] options The options of the Interest.
+ * @return The matched entry. @c NULL if none.
+ */
+ndn_cs_entry_t*
+ndn_cs_match(ndn_cs_t* self, const ndn_parsed_name_t* name, interest_options_t* options);
+
+void
+ndn_cs_remove_entry(ndn_cs_t* self, ndn_cs_entry_t* entry);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FORWARDER_CS_H_
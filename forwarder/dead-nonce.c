@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "dead-nonce.h"
+
+#define DEAD_NONCE_BUCKET(self, i) (&(self)->slots[(size_t)(i) * NDN_DEAD_NONCE_BUCKET_SLOTS])
+
+void
+ndn_dead_nonce_init(void* memory, uint32_t capacity, uint32_t lifetime)
+{
+  ndn_dead_nonce_t* self = (ndn_dead_nonce_t*)memory;
+  uint32_t i;
+
+  self->bucket_mask = capacity / NDN_DEAD_NONCE_BUCKET_SLOTS - 1;
+  self->lifetime = lifetime;
+  for(i = 0; i < capacity; i ++){
+    self->slots[i].fingerprint = 0;
+    self->slots[i].expire_time = 0;
+  }
+}
+
+static inline uint64_t
+dead_nonce_mix(uint64_t x)
+{
+  // The finalizer of SplitMix64
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+static inline bool
+dead_nonce_alive(const ndn_dead_nonce_slot_t* slot, uint32_t now)
+{
+  return slot->fingerprint != 0 && (int32_t)(slot->expire_time - now) > 0;
+}
+
+bool
+ndn_dead_nonce_test_and_add(ndn_dead_nonce_t* self,
+                            uint32_t name_hash,
+                            uint32_t nonce,
+                            ndn_time_ms_t now)
+{
+  uint64_t key;
+  uint32_t fingerprint, bucket[2], now32 = (uint32_t)now;
+  ndn_dead_nonce_slot_t *slot, *victim = NULL;
+  int b, i;
+
+  key = dead_nonce_mix(((uint64_t)name_hash << 32) | nonce);
+  fingerprint = (uint32_t)(key >> 32);
+  if(fingerprint == 0){
+    fingerprint = 1;
+  }
+  // The alternative bucket is derived from the fingerprint, as in a cuckoo filter
+  bucket[0] = (uint32_t)key & self->bucket_mask;
+  bucket[1] = (bucket[0] ^ (uint32_t)dead_nonce_mix(fingerprint)) & self->bucket_mask;
+
+  // Start from a slot picked by the fingerprint, so pairs added in the same
+  // millisecond do not keep replacing the same slot
+  for(b = 0; b < 2; b ++){
+    for(i = 0; i < NDN_DEAD_NONCE_BUCKET_SLOTS; i ++){
+      slot = &DEAD_NONCE_BUCKET(self, bucket[b])[(i + fingerprint) % NDN_DEAD_NONCE_BUCKET_SLOTS];
+      if(slot->fingerprint == fingerprint && dead_nonce_alive(slot, now32)){
+        slot->expire_time = now32 + self->lifetime;
+        return true;
+      }
+      // Prefer a dead slot, then the one expiring first
+      if(victim == NULL || (dead_nonce_alive(victim, now32) &&
+         (!dead_nonce_alive(slot, now32) ||
+          (int32_t)(slot->expire_time - victim->expire_time) < 0))){
+        victim = slot;
+      }
+    }
+  }
+
+  victim->fingerprint = fingerprint;
+  victim->expire_time = now32 + self->lifetime;
+  return false;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef FORWARDER_DEAD_NONCE_H_
+#define FORWARDER_DEAD_NONCE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "../util/uniform-time.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup NDNFwdDeadNonce Dead Nonce List
+ * @brief Recently seen (Name, Nonce) pairs, used to detect looping Interests.
+ *
+ * A fixed-size table of 32-bit fingerprints with an expiry time each.
+ * A pair may live in either of two buckets, so a lookup reads at most two cache lines.
+ * When both buckets are full, the entry closest to expiry is replaced.
+ * Pairs stay until they expire, independent of the PIT.
+ * False positives are possible but as rare as a 32-bit fingerprint collision.
+ * @ingroup NDNFwd
+ * @{
+ */
+
+/** The number of slots in a bucket.
+ */
+#define NDN_DEAD_NONCE_BUCKET_SLOTS 4
+
+/** Dead Nonce List slot.
+ */
+typedef struct ndn_dead_nonce_slot {
+  /** Fingerprint of the (Name, Nonce) pair. 0 if empty.
+   */
+  uint32_t fingerprint;
+
+  /** The lower 32 bits of the expiry timestamp.
+   */
+  uint32_t expire_time;
+} ndn_dead_nonce_slot_t;
+
+/** Dead Nonce List.
+ */
+typedef struct ndn_dead_nonce {
+  /** The number of buckets minus 1. The number of buckets is a power of 2.
+   */
+  uint32_t bucket_mask;
+
+  /** How long a pair stays in milliseconds.
+   */
+  uint32_t lifetime;
+
+  ndn_dead_nonce_slot_t slots[];
+} ndn_dead_nonce_t;
+
+#define NDN_DEAD_NONCE_RESERVE_SIZE(entry_count) \
+  (sizeof(ndn_dead_nonce_t) + sizeof(ndn_dead_nonce_slot_t) * (entry_count))
+
+/** Initialize a Dead Nonce List at specified memory space.
+ * @param[in, out] memory Memory reserved for the list.
+ * @param[in] capacity Maximum number of pairs.
+ *                     A power of 2, at least #NDN_DEAD_NONCE_BUCKET_SLOTS.
+ * @param[in] lifetime How long a pair stays in milliseconds.
+ */
+void
+ndn_dead_nonce_init(void* memory, uint32_t capacity, uint32_t lifetime);
+
+/** Record a (Name, Nonce) pair, and tell whether it was seen.
+ *
+ * A pair already seen gets its lifetime renewed.
+ * @param[in, out] self Dead Nonce List.
+ * @param[in] name_hash The hash of the Name, as ndn_parsed_name#hashes of all components.
+ * @param[in] nonce The Nonce.
+ * @param[in] now The current time.
+ * @return Whether the pair has been seen within the lifetime.
+ */
+bool
+ndn_dead_nonce_test_and_add(ndn_dead_nonce_t* self,
+                            uint32_t name_hash,
+                            uint32_t nonce,
+                            ndn_time_ms_t now);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FORWARDER_DEAD_NONCE_H_
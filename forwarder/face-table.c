@@ -12,8 +12,12 @@ void ndn_facetab_init(void* memory, ndn_table_id_t capacity){
   ndn_table_id_t i;
   ndn_face_table_t* self = (ndn_face_table_t*)memory;
   self->capacity = capacity;
+  self->epoch = 0;
+  self->measures = (ndn_face_measure_t*)&self->slots[capacity];
+  self->unregistered = (uint32_t*)&self->measures[capacity];
   for(i = 0; i < capacity; i ++){
     self->slots[i] = NULL;
+    self->unregistered[i] = 0;
   }
 }
 
@@ -22,6 +26,11 @@ ndn_table_id_t ndn_facetab_register(ndn_face_table_t* self, ndn_face_intf_t* fac
   for(i = 0; i < self->capacity; i ++){
     if(self->slots[i] == NULL){
       self->slots[i] = face;
+      self->measures[i].srtt = 0;
+      self->measures[i].rttvar = 0;
+      self->measures[i].credit = 0;
+      self->measures[i].cost = NDN_FACE_DEFAULT_COST;
+      self->measures[i].weight = 1;
       return i;
     }
   }
@@ -30,4 +39,18 @@ ndn_table_id_t ndn_facetab_register(ndn_face_table_t* self, ndn_face_intf_t* fac
 
 void ndn_facetab_unregister(ndn_face_table_t* self, ndn_table_id_t id){
   self->slots[id] = NULL;
+  self->epoch ++;
+  self->unregistered[id] = self->epoch;
+}
+
+void ndn_facetab_drop_stale(const ndn_face_table_t* self, ndn_faceset_t* faces, uint32_t since){
+  ndn_faceset_t rest = *faces;
+  size_t id;
+
+  while(!faceset_empty(&rest)){
+    id = faceset_pop_least(&rest);
+    if(ndn_facetab_stale(self, id, since)){
+      faceset_unset(faces, id);
+    }
+  }
 }
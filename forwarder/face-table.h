@@ -11,6 +11,7 @@
 
 #include "face.h"
 #include "../ndn-constants.h"
+#include "../util/bit-operations.h"
 
 /** @defgroup NDNFwdFaceTab Face Table
  * @brief Face Table.
@@ -18,6 +19,33 @@
  * @{
  */
 
+/** Measurements of a face, used by forwarding strategies.
+ *
+ * Reset when a face gets the ID.
+ */
+typedef struct ndn_face_measure{
+  /** Smoothed round-trip time in milliseconds.
+   * 0 if not measured yet.
+   */
+  uint32_t srtt;
+
+  /** Round-trip time variation in milliseconds.
+   */
+  uint32_t rttvar;
+
+  /** Credit of the weighted round-robin, in the range of the weights.
+   */
+  int32_t credit;
+
+  /** Routing cost. #NDN_FACE_DEFAULT_COST by default.
+   */
+  uint16_t cost;
+
+  /** Share of Interests under load-balancing. 1 by default, 0 to exclude the face.
+   */
+  uint16_t weight;
+}ndn_face_measure_t;
+
 /** Face Table.
  *
  * It assigns an unique ID to all faces.
@@ -25,6 +53,21 @@
 typedef struct ndn_face_table{
   ndn_table_id_t capacity;
 
+  /** Number of unregistrations so far.
+   * Entries referring to faces are stamped with it when cleaned of unregistered faces.
+   */
+  uint32_t epoch;
+
+  /** Measurements of all faces, indexed by face ID.
+   * Stored right after @c slots.
+   */
+  ndn_face_measure_t* measures;
+
+  /** The @c epoch at the last unregistration of each face ID, indexed by face ID.
+   * Stored right after @c measures.
+   */
+  uint32_t* unregistered;
+
   /** All registered faces.
    * NULL for empty entries.
    */
@@ -35,7 +78,8 @@ typedef struct ndn_face_table{
  * @param[in] entry_count Maximum number of entries.
  */
 #define NDN_FACE_TABLE_RESERVE_SIZE(entry_count) \
-  (sizeof(ndn_face_table_t) + sizeof(ndn_face_intf_t*) * (entry_count))
+  (sizeof(ndn_face_table_t) + \
+   (sizeof(ndn_face_intf_t*) + sizeof(ndn_face_measure_t) + sizeof(uint32_t)) * (entry_count))
 
 /** Initialize FaceTable at specified memory space.
  * @param[in, out] memory Memory reserved for FaceTable.
@@ -54,6 +98,9 @@ ndn_table_id_t
 ndn_facetab_register(ndn_face_table_t* self, ndn_face_intf_t* face);
 
 /** Unregister a face from FaceTable only.
+ *
+ * The ID is free at once. Entries still referring to it find it stale with
+ * ndn_facetab_stale(), so it is never mistaken for the next face getting it.
  * @param[in, out] self FaceTable.
  * @param[in] face The face to unregister.
  * @pre <tt>id < self->ndn_face_table_t#capacity</tt>
@@ -61,6 +108,28 @@ ndn_facetab_register(ndn_face_table_t* self, ndn_face_intf_t* face);
 void
 ndn_facetab_unregister(ndn_face_table_t* self, ndn_table_id_t id);
 
+/** Tell whether a face ID referred to since an epoch has been unregistered afterwards.
+ * @param[in] self FaceTable.
+ * @param[in] id The face ID.
+ * @param[in] since The ndn_face_table#epoch when the reference was made or last checked.
+ * @remark Epochs wrap around, so a reference left unchecked over 2^31 unregistrations
+ *         may be taken for a fresh one.
+ */
+static inline bool
+ndn_facetab_stale(const ndn_face_table_t* self, ndn_table_id_t id, uint32_t since){
+  return (int32_t)(self->unregistered[id] - since) > 0;
+}
+
+/** Remove the faces unregistered after an epoch from a face set.
+ *
+ * Costs O(faces in the set).
+ * @param[in] self FaceTable.
+ * @param[in, out] faces The face set.
+ * @param[in] since The ndn_face_table#epoch when @c faces was last checked.
+ */
+void
+ndn_facetab_drop_stale(const ndn_face_table_t* self, ndn_faceset_t* faces, uint32_t since);
+
 /*@}*/
 
 #endif // FORWARDER_FACE_TABLE_H_
@@ -14,6 +14,7 @@
 #include <stddef.h>
 #include "../ndn-enums.h"
 #include "../ndn-constants.h"
+#include "../util/pktbuf.h"
 
 #define container_of(ptr, type, member) \
   ((type *)((char *)(1 ? (ptr) : &((type *)0)->member) - offsetof(type, member)))
@@ -41,6 +42,11 @@ typedef int (*ndn_face_intf_up)(struct ndn_face_intf* self);
 typedef int (*ndn_face_intf_send)(struct ndn_face_intf* self,
                                   const uint8_t* packet, uint32_t size);
 
+/** Send out a packet buffer, keeping a reference if it's sent later.
+ * @sa ndn_face_send_buf
+ */
+typedef int (*ndn_face_intf_send_buf)(struct ndn_face_intf* self, ndn_pktbuf_t* buf);
+
 /** Shutdown the face temporarily.
  * @sa ndn_face_down
  */
@@ -70,6 +76,15 @@ typedef struct ndn_face_intf {
    */
   ndn_face_intf_send send;
 
+  /** [Optional] Send out a packet buffer.
+   *
+   * Faces queueing packets asynchronously implement this to keep a reference
+   * instead of copying. The reference may be dropped on the face's own thread.
+   * @c NULL if not supported.
+   * @sa ndn_face_send_buf
+   */
+  ndn_face_intf_send_buf send_buf;
+
   /** Shutdown the face temporarily.
    * @sa ndn_face_down
    */
@@ -126,6 +141,24 @@ ndn_face_send(ndn_face_intf_t* self, const uint8_t* packet, uint32_t size)
   return self->send(self, packet, size);
 }
 
+/** Send out a packet buffer.
+ *
+ * The face takes its own reference to @c buf if it needs the packet after returning.
+ * Faces without ndn_face_intf#send_buf send the bytes of @c buf.
+ * @param[in, out] self The face through which to send.
+ * @param[in] buf The packet buffer.
+ * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
+ */
+static inline int
+ndn_face_send_buf(ndn_face_intf_t* self, ndn_pktbuf_t* buf)
+{
+  if (self->state != NDN_FACE_STATE_UP)
+    self->up(self);
+  if (self->send_buf != NULL)
+    return self->send_buf(self, buf);
+  return self->send(self, buf->data, buf->length);
+}
+
 /** Shutdown the face temporarily.
  * @param[in, out] self Input. The interface to turn off.
  * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
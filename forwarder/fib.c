@@ -12,9 +12,11 @@ static inline void
 ndn_fib_entry_reset(ndn_fib_entry_t* self)
 {
   self->nametree_id = NDN_INVALID_ID;
-  self->nexthop = 0;
+  faceset_clear(&self->nexthop);
   self->on_interest = NULL;
   self->userdata = NULL;
+  self->strategy = NULL;
+  self->face_epoch = 0;
 }
 
 void
@@ -24,16 +26,28 @@ ndn_fib_init(void* memory, ndn_table_id_t capacity, ndn_nametree_t* nametree)
   ndn_fib_t* self = (ndn_fib_t*)memory;
   self->capacity = capacity;
   self->nametree = nametree;
+  self->facetab = NULL;
   for(i = 0; i < capacity; i ++){
     ndn_fib_entry_reset(&self->slots[i]);
+    self->slots[i].next_free = i + 1;
+  }
+  if(capacity > 0){
+    self->slots[capacity - 1].next_free = NDN_INVALID_ID;
+    self->free_head = 0;
+  }else{
+    self->free_head = NDN_INVALID_ID;
   }
 }
 
 static inline void
 ndn_fib_remove_entry(ndn_fib_t* self, ndn_fib_entry_t* entry)
 {
-  ndn_nametree_at(self->nametree, entry->nametree_id)->fib_id = NDN_INVALID_ID;
+  nametree_entry_t* node = ndn_nametree_at(self->nametree, entry->nametree_id);
+  node->fib_id = NDN_INVALID_ID;
+  ndn_nametree_unref(self->nametree, node);
   ndn_fib_entry_reset(entry);
+  entry->next_free = self->free_head;
+  self->free_head = entry - self->slots;
 }
 
 void
@@ -42,66 +56,90 @@ ndn_fib_remove_entry_if_empty(ndn_fib_t* self, ndn_fib_entry_t* entry)
   if(entry->nametree_id == NDN_INVALID_ID){
     return;
   }
-  if(entry->nexthop == 0 && entry->on_interest == NULL){
+  if(faceset_empty(&entry->nexthop) && entry->on_interest == NULL){
     ndn_fib_remove_entry(self, entry);
   }
 }
 
-void
-ndn_fib_unregister_face(ndn_fib_t* self, ndn_table_id_t face_id)
+// Drop the next hops unregistered since the entry was last looked up
+static inline ndn_fib_entry_t*
+ndn_fib_entry_refresh(ndn_fib_t* self, ndn_fib_entry_t* entry)
+{
+  if(self->facetab != NULL && entry->face_epoch != self->facetab->epoch){
+    ndn_facetab_drop_stale(self->facetab, &entry->nexthop, entry->face_epoch);
+    entry->face_epoch = self->facetab->epoch;
+  }
+  return entry;
+}
+
+// Refresh an entry found by a lookup, deleting it if its last next hop is gone
+static ndn_fib_entry_t*
+ndn_fib_entry_check(ndn_fib_t* self, ndn_fib_entry_t* entry)
 {
-  for (ndn_table_id_t i = 0; i < self -> capacity; ++i) {
-    self->slots[i].nexthop = bitset_unset(self->slots[i].nexthop , face_id);
-    ndn_fib_remove_entry_if_empty(self, &self->slots[i]);
+  ndn_fib_entry_refresh(self, entry);
+  if(faceset_empty(&entry->nexthop) && entry->on_interest == NULL){
+    ndn_fib_remove_entry(self, entry);
+    return NULL;
   }
+  return entry;
 }
 
 static ndn_table_id_t
 ndn_fib_add_new_entry(ndn_fib_t* fib , int nametree_id)
 {
-  ndn_table_id_t i;
-  for (i = 0; i < fib -> capacity; ++i) {
-    if (fib->slots[i].nametree_id == NDN_INVALID_ID) {
-      ndn_fib_entry_reset(&fib->slots[i]);
-      fib->slots[i].nametree_id = nametree_id;
-      return i;
-    }
+  ndn_table_id_t i = fib->free_head;
+  if (i == NDN_INVALID_ID) {
+    return NDN_INVALID_ID;
   }
-  return NDN_INVALID_ID;
+  fib->free_head = fib->slots[i].next_free;
+  ndn_fib_entry_reset(&fib->slots[i]);
+  fib->slots[i].nametree_id = nametree_id;
+  fib->slots[i].face_epoch = (fib->facetab != NULL ? fib->facetab->epoch : 0);
+  fib->slots[i].next_free = NDN_INVALID_ID;
+  return i;
 }
 
 ndn_fib_entry_t*
-ndn_fib_find_or_insert(ndn_fib_t* self, uint8_t* prefix, size_t length)
+ndn_fib_find_or_insert(ndn_fib_t* self, const ndn_parsed_name_t* prefix)
 {
-  nametree_entry_t* entry = ndn_nametree_find_or_insert(self->nametree, prefix, length);
+  nametree_entry_t* entry = ndn_nametree_find_or_insert(self->nametree, prefix);
   if(entry == NULL) {
     return NULL;
   }
   if(entry->fib_id == NDN_INVALID_ID) {
     entry->fib_id = ndn_fib_add_new_entry(self, ndn_nametree_getid(self->nametree, entry));
     if(entry->fib_id == NDN_INVALID_ID) {
+      ndn_nametree_release(self->nametree, entry);
       return NULL;
     }
+    ndn_nametree_ref(self->nametree, entry);
   }
-  return &self->slots[entry->fib_id];
+  return ndn_fib_entry_refresh(self, &self->slots[entry->fib_id]);
 }
 
 ndn_fib_entry_t*
-ndn_fib_find(ndn_fib_t* self, uint8_t* prefix, size_t length)
+ndn_fib_find(ndn_fib_t* self, const ndn_parsed_name_t* prefix)
 {
-  nametree_entry_t* entry = ndn_nametree_find(self->nametree, prefix, length);
+  nametree_entry_t* entry = ndn_nametree_find(self->nametree, prefix);
   if (entry == NULL || entry->fib_id == NDN_INVALID_ID) {
     return NULL;
   }
-  return &self->slots[entry->fib_id];
+  return ndn_fib_entry_check(self, &self->slots[entry->fib_id]);
 }
 
 ndn_fib_entry_t*
-ndn_fib_prefix_match(ndn_fib_t* self, uint8_t* prefix, size_t length)
+ndn_fib_prefix_match(ndn_fib_t* self, const ndn_parsed_name_t* name)
 {
-  nametree_entry_t* entry = ndn_nametree_prefix_match(self->nametree, prefix, length, NDN_NAMETREE_FIB_TYPE);
-  if (entry == NULL || entry->fib_id == NDN_INVALID_ID) {
-    return NULL;
+  nametree_entry_t* node;
+  ndn_fib_entry_t* entry = NULL;
+
+  // A deleted entry leaves a shorter prefix to match
+  while (entry == NULL) {
+    node = ndn_nametree_prefix_match(self->nametree, name, NDN_NAMETREE_FIB_TYPE);
+    if (node == NULL || node->fib_id == NDN_INVALID_ID) {
+      return NULL;
+    }
+    entry = ndn_fib_entry_check(self, &self->slots[node->fib_id]);
   }
-  return &self->slots[entry->fib_id];
+  return entry;
 }
@@ -11,8 +11,11 @@
 
 #include "../util/bit-operations.h"
 #include "callback-funcs.h"
+#include "face-table.h"
 #include "name-tree.h"
 
+struct ndn_strategy;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -27,9 +30,9 @@ extern "C" {
  * FIB entry.
  */
 typedef struct ndn_fib_entry {
-  /** A bitset recording all next hops.
+  /** A set recording all next hops.
    */
-  ndn_bitset_t nexthop;
+  ndn_faceset_t nexthop;
 
   /** OnOnterest callback function if registered.
    */
@@ -39,10 +42,24 @@ typedef struct ndn_fib_entry {
    */
   void* userdata;
 
+  /** The strategy forwarding Interests under this prefix.
+   * @c NULL for multicast.
+   */
+  const struct ndn_strategy* strategy;
+
+  /** The ndn_face_table#epoch when @c nexthop was last cleaned of unregistered faces.
+   */
+  uint32_t face_epoch;
+
   /** NameTree entry's ID.
    * #NDN_INVALID_ID if the entry is empty.
    */
   ndn_table_id_t nametree_id;
+
+  /** The next free entry if this entry is empty.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t next_free;
 } ndn_fib_entry_t;
 
 /**
@@ -50,7 +67,19 @@ typedef struct ndn_fib_entry {
  */
 typedef struct ndn_fib {
   ndn_nametree_t* nametree;
+
+  /** FaceTable whose unregistered faces are dropped from next hops on lookup.
+   * Set by the forwarder. @c NULL if faces are never unregistered.
+   */
+  const ndn_face_table_t* facetab;
+
   ndn_table_id_t capacity;
+
+  /** The first free entry.
+   * All free entries are linked by ndn_fib_entry#next_free.
+   */
+  ndn_table_id_t free_head;
+
   ndn_fib_entry_t slots[];
 } ndn_fib_t;
 
@@ -60,20 +89,17 @@ typedef struct ndn_fib {
 void
 ndn_fib_init(void* memory, ndn_table_id_t capacity, ndn_nametree_t* nametree);
 
-void
-ndn_fib_unregister_face(ndn_fib_t* self, ndn_table_id_t face_id);
-
 ndn_fib_entry_t*
-ndn_fib_find_or_insert(ndn_fib_t* self, uint8_t* prefix, size_t length);
+ndn_fib_find_or_insert(ndn_fib_t* self, const ndn_parsed_name_t* prefix);
 
 ndn_fib_entry_t*
-ndn_fib_find(ndn_fib_t* self, uint8_t* prefix, size_t length);
+ndn_fib_find(ndn_fib_t* self, const ndn_parsed_name_t* prefix);
 
 void
 ndn_fib_remove_entry_if_empty(ndn_fib_t* self, ndn_fib_entry_t* entry);
 
 ndn_fib_entry_t*
-ndn_fib_prefix_match(ndn_fib_t* self, uint8_t* prefix, size_t length);
+ndn_fib_prefix_match(ndn_fib_t* self, const ndn_parsed_name_t* name);
 
 /*@}*/
 
@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "forwarder-pool.h"
+#include "fib.h"
+#include "ingress-ring.h"
+#include "parsed-name.h"
+#include "../ndn-error-code.h"
+#include "../encode/tlv.h"
+#include "../encode/forwarder-helper.h"
+
+/** Parse a prefix given by the application, as the shards do.
+ */
+static int
+pool_parse_prefix(ndn_parsed_name_t* parsed, uint8_t* prefix, size_t length)
+{
+  int ret = tlv_check_type_length(prefix, length, TLV_Name);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  return ndn_parsed_name_init(parsed, prefix, length);
+}
+
+size_t
+ndn_forwarder_pool_memory_size(uint8_t shard_cnt, const ndn_forwarder_config_t* config)
+{
+  return ndn_forwarder_memory_size(config) * shard_cnt;
+}
+
+int
+ndn_forwarder_pool_init(ndn_forwarder_pool_t* self,
+                        uint8_t shard_cnt,
+                        uint8_t prefix_len,
+                        const ndn_forwarder_config_t* config)
+{
+  ndn_forwarder_config_t shard_config;
+  uint8_t* memory;
+  uint8_t i;
+  int ret;
+
+  if(self == NULL || config == NULL)
+    return NDN_INVALID_POINTER;
+  if(shard_cnt == 0 || shard_cnt > NDN_FORWARDER_POOL_MAX_SHARDS)
+    return NDN_OVERSIZE;
+  // Sharding by the whole name would part CanBePrefix Interests from their Data
+  if(prefix_len == 0)
+    return NDN_OVERSIZE;
+
+  self->shard_cnt = shard_cnt;
+  self->prefix_len = prefix_len;
+  shard_config = *config;
+  shard_config.msgqueue = &self->msgqueues[0];
+  ret = ndn_forwarder_check_config(&shard_config);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  // One allocation for all shards, made once the config is known to be good,
+  // so a failing shard cannot leak the memory of the ones before it
+  memory = (uint8_t*)config->memory;
+  if(memory == NULL){
+    memory = (uint8_t*)config->alloc(ndn_forwarder_pool_memory_size(shard_cnt, config));
+    if(memory == NULL)
+      return NDN_FWD_NO_MEMORY;
+  }
+  for(i = 0; i < shard_cnt; i ++){
+    shard_config.memory = memory + ndn_forwarder_memory_size(config) * i;
+    shard_config.msgqueue = &self->msgqueues[i];
+    ret = ndn_fwd_init(&self->shards[i], &shard_config);
+    if(ret != NDN_SUCCESS)
+      return ret;
+  }
+  return NDN_SUCCESS;
+}
+
+// FNV-1a over the encoding of the leading components, kept by the parsed name
+static int
+pool_shard_of_parsed(ndn_forwarder_pool_t* self, const ndn_parsed_name_t* name)
+{
+  uint16_t depth = name->count;
+  if(self->prefix_len < depth)
+    depth = self->prefix_len;
+  return name->hashes[depth] % self->shard_cnt;
+}
+
+int
+ndn_forwarder_pool_shard_of_name(ndn_forwarder_pool_t* self, uint8_t* name, size_t length)
+{
+  ndn_parsed_name_t parsed;
+  int ret = ndn_parsed_name_init(&parsed, name, length);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  return pool_shard_of_parsed(self, &parsed);
+}
+
+int
+ndn_forwarder_pool_shard_of_packet(ndn_forwarder_pool_t* self, uint8_t* packet, size_t length)
+{
+  ndn_parsed_packet_t parsed;
+  int ret;
+
+  if(self == NULL || packet == NULL)
+    return NDN_INVALID_POINTER;
+  // A Nack goes to the shard of its Interest
+  ret = ndn_parsed_packet_init(&parsed, packet, length);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  return pool_shard_of_parsed(self, &parsed.name);
+}
+
+void
+ndn_forwarder_pool_process(ndn_forwarder_pool_t* self, uint8_t shard)
+{
+  ndn_fwd_process(&self->shards[shard]);
+}
+
+int
+ndn_forwarder_pool_receive(ndn_forwarder_pool_t* self,
+                           ndn_face_intf_t* face,
+                           uint8_t* packet,
+                           size_t length)
+{
+  ndn_parsed_packet_t parsed;
+  int ret = ndn_parsed_packet_init(&parsed, packet, length);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  return ndn_fwd_receive_parsed(&self->shards[pool_shard_of_parsed(self, &parsed.name)],
+                                face, &parsed);
+}
+
+int
+ndn_forwarder_pool_enqueue(ndn_forwarder_pool_t* self,
+                           ndn_face_intf_t* face,
+                           uint8_t* packet,
+                           size_t length)
+{
+  ndn_parsed_packet_t parsed;
+  ndn_ingress_ring_t* ingress;
+  int ret;
+
+  if(packet == NULL)
+    return NDN_INVALID_POINTER;
+  ret = ndn_parsed_packet_init(&parsed, (uint8_t*)packet, length);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  // The worker takes the parsed header from the ring, as ndn_fwd_enqueue() leaves it
+  ingress = self->shards[pool_shard_of_parsed(self, &parsed.name)].ingress;
+  if(ingress == NULL)
+    return NDN_INVALID_POINTER;
+  return ndn_ingress_ring_push(ingress, face, packet, length, &parsed);
+}
+
+int
+ndn_forwarder_pool_register_face(ndn_forwarder_pool_t* self, ndn_face_intf_t* face)
+{
+  ndn_table_id_t face_id;
+  uint8_t i, j;
+  int ret;
+
+  if(face == NULL)
+    return NDN_INVALID_POINTER;
+  if(face->face_id != NDN_INVALID_ID)
+    return NDN_FWD_NO_EFFECT;
+
+  ret = ndn_fwd_register_face(&self->shards[0], face);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  face_id = face->face_id;
+  // All shards have the same FaceTable, so they assign the same ID
+  for(i = 1; i < self->shard_cnt; i ++){
+    face->face_id = NDN_INVALID_ID;
+    ret = ndn_fwd_register_face(&self->shards[i], face);
+    if(ret == NDN_SUCCESS && face->face_id != face_id){
+      ndn_fwd_unregister_face(&self->shards[i], face);
+      ret = NDN_FWD_INVALID_FACE;
+    }
+    if(ret != NDN_SUCCESS){
+      for(j = 0; j < i; j ++){
+        face->face_id = face_id;
+        ndn_fwd_unregister_face(&self->shards[j], face);
+      }
+      face->face_id = NDN_INVALID_ID;
+      return ret;
+    }
+  }
+  return NDN_SUCCESS;
+}
+
+int
+ndn_forwarder_pool_unregister_face(ndn_forwarder_pool_t* self, ndn_face_intf_t* face)
+{
+  ndn_table_id_t face_id;
+  uint8_t i;
+  int ret = NDN_SUCCESS;
+
+  if(face == NULL)
+    return NDN_INVALID_POINTER;
+  face_id = face->face_id;
+  for(i = 0; i < self->shard_cnt && ret == NDN_SUCCESS; i ++){
+    face->face_id = face_id;
+    ret = ndn_fwd_unregister_face(&self->shards[i], face);
+  }
+  return ret;
+}
+
+int
+ndn_forwarder_pool_add_route(ndn_forwarder_pool_t* self,
+                             ndn_face_intf_t* face,
+                             uint8_t* prefix,
+                             size_t length)
+{
+  uint8_t i, j;
+  int ret;
+
+  for(i = 0; i < self->shard_cnt; i ++){
+    ret = ndn_fwd_add_route(&self->shards[i], face, prefix, length);
+    if(ret != NDN_SUCCESS){
+      // Keep the shards' FIBs identical
+      for(j = 0; j < i; j ++){
+        ndn_fwd_remove_route(&self->shards[j], face, prefix, length);
+      }
+      return ret;
+    }
+  }
+  return NDN_SUCCESS;
+}
+
+int
+ndn_forwarder_pool_remove_route(ndn_forwarder_pool_t* self,
+                                ndn_face_intf_t* face,
+                                uint8_t* prefix,
+                                size_t length)
+{
+  uint8_t i, j;
+  int ret;
+
+  for(i = 0; i < self->shard_cnt; i ++){
+    ret = ndn_fwd_remove_route(&self->shards[i], face, prefix, length);
+    if(ret != NDN_SUCCESS){
+      // Keep the shards' FIBs identical
+      for(j = 0; j < i; j ++){
+        ndn_fwd_add_route(&self->shards[j], face, prefix, length);
+      }
+      return ret;
+    }
+  }
+  return NDN_SUCCESS;
+}
+
+int
+ndn_forwarder_pool_post_route_batch(ndn_forwarder_pool_t* self, ndn_route_batch_t* batch)
+{
+  uint8_t i;
+
+  if(batch == NULL || (batch->updates == NULL && batch->count > 0))
+    return NDN_INVALID_POINTER;
+  // Only the control thread stores a batch, so empty slots stay empty until the stores below
+  for(i = 0; i < self->shard_cnt; i ++){
+    if(atomic_load_explicit(&self->shards[i].route_batch, memory_order_relaxed) != NULL)
+      return NDN_FWD_ROUTE_BATCH_BUSY;
+  }
+  atomic_store_explicit(&batch->pending, self->shard_cnt, memory_order_relaxed);
+  atomic_store_explicit(&batch->failures, 0, memory_order_relaxed);
+  for(i = 0; i < self->shard_cnt; i ++){
+    atomic_store_explicit(&self->shards[i].route_batch, batch, memory_order_release);
+  }
+  return NDN_SUCCESS;
+}
+
+int
+ndn_forwarder_pool_set_strategy(ndn_forwarder_pool_t* self,
+                                uint8_t* prefix,
+                                size_t length,
+                                const ndn_strategy_t* strategy)
+{
+  const ndn_strategy_t* former[NDN_FORWARDER_POOL_MAX_SHARDS];
+  ndn_parsed_name_t parsed;
+  ndn_fib_entry_t* fib_entry;
+  uint8_t i, j;
+  int ret;
+
+  ret = pool_parse_prefix(&parsed, prefix, length);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  for(i = 0; i < self->shard_cnt; i ++){
+    fib_entry = ndn_fib_find(self->shards[i].fib, &parsed);
+    former[i] = (fib_entry != NULL ? fib_entry->strategy : NULL);
+    ret = ndn_fwd_set_strategy(&self->shards[i], prefix, length, strategy);
+    if(ret != NDN_SUCCESS){
+      // Keep the shards' FIBs identical
+      for(j = 0; j < i; j ++){
+        ndn_fwd_set_strategy(&self->shards[j], prefix, length, former[j]);
+      }
+      return ret;
+    }
+  }
+  return NDN_SUCCESS;
+}
+
+int
+ndn_forwarder_pool_register_prefix(ndn_forwarder_pool_t* self,
+                                   uint8_t* prefix,
+                                   size_t length,
+                                   ndn_on_interest_func on_interest,
+                                   void* userdata)
+{
+  uint8_t i, j;
+  int ret;
+
+  for(i = 0; i < self->shard_cnt; i ++){
+    ret = ndn_fwd_register_prefix(&self->shards[i], prefix, length, on_interest, userdata);
+    if(ret != NDN_SUCCESS){
+      // Keep the shards' FIBs identical
+      for(j = 0; j < i; j ++){
+        ndn_fwd_unregister_prefix(&self->shards[j], prefix, length);
+      }
+      return ret;
+    }
+  }
+  return NDN_SUCCESS;
+}
+
+int
+ndn_forwarder_pool_unregister_prefix(ndn_forwarder_pool_t* self, uint8_t* prefix, size_t length)
+{
+  ndn_fib_entry_t former[NDN_FORWARDER_POOL_MAX_SHARDS];
+  ndn_parsed_name_t parsed;
+  ndn_fib_entry_t* fib_entry;
+  uint8_t i, j;
+  int ret;
+
+  ret = pool_parse_prefix(&parsed, prefix, length);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  for(i = 0; i < self->shard_cnt; i ++){
+    // The entry may be removed with the producer, so its strategy is kept as well
+    fib_entry = ndn_fib_find(self->shards[i].fib, &parsed);
+    if(fib_entry != NULL){
+      former[i] = *fib_entry;
+    }
+    ret = ndn_fwd_unregister_prefix(&self->shards[i], prefix, length);
+    if(ret != NDN_SUCCESS){
+      // Keep the shards' FIBs identical
+      for(j = 0; j < i; j ++){
+        ndn_fwd_register_prefix(&self->shards[j], prefix, length,
+                                former[j].on_interest, former[j].userdata);
+        ndn_fwd_set_strategy(&self->shards[j], prefix, length, former[j].strategy);
+      }
+      return ret;
+    }
+  }
+  return NDN_SUCCESS;
+}
+
+int
+ndn_forwarder_pool_express_interest(ndn_forwarder_pool_t* self,
+                                    uint8_t* interest,
+                                    size_t length,
+                                    ndn_on_data_func on_data,
+                                    ndn_on_timeout_func on_timeout,
+                                    void* userdata)
+{
+  return ndn_forwarder_pool_express_interest_with_nack(self, interest, length,
+                                                       on_data, on_timeout, NULL, userdata);
+}
+
+int
+ndn_forwarder_pool_express_interest_with_nack(ndn_forwarder_pool_t* self,
+                                              uint8_t* interest,
+                                              size_t length,
+                                              ndn_on_data_func on_data,
+                                              ndn_on_timeout_func on_timeout,
+                                              ndn_on_nack_func on_nack,
+                                              void* userdata)
+{
+  ndn_parsed_packet_t parsed;
+  int ret = ndn_parsed_packet_init(&parsed, interest, length);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  return ndn_fwd_express_interest_parsed(&self->shards[pool_shard_of_parsed(self, &parsed.name)],
+                                         &parsed, on_data, on_timeout, on_nack, userdata);
+}
+
+int
+ndn_forwarder_pool_put_data(ndn_forwarder_pool_t* self, uint8_t* data, size_t length)
+{
+  ndn_parsed_packet_t parsed;
+  int ret = ndn_parsed_packet_init(&parsed, data, length);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  return ndn_fwd_put_data_parsed(&self->shards[pool_shard_of_parsed(self, &parsed.name)], &parsed);
+}
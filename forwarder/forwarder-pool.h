@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef FORWARDER_FORWARDER_POOL_H
+#define FORWARDER_FORWARDER_POOL_H
+
+#include "forwarder.h"
+#include "../ndn-constants.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup NDNFwdPool Forwarder Pool
+ * @brief Forwarder instances sharded by name.
+ *
+ * Each shard is a forwarder instance with its own PIT, CS and message queue,
+ * driven by one worker thread of the platform.
+ * A packet is steered to a shard by the hash of the first components of its name,
+ * so an Interest and its Data always meet in the same shard.
+ * The FIB and the faces are replicated to all shards.
+ * Every worker sends through the same faces, so ndn_face_intf#send and
+ * ndn_face_intf#send_buf of a face may be called from several worker threads at once,
+ * and must be safe to call so.
+ * The faces must be changed while the workers are paused.
+ * Routes can be changed while the workers run by ndn_forwarder_pool_post_route_batch(),
+ * or while they are paused by the other route functions.
+ * @ingroup NDNFwd
+ * @{
+ */
+
+/** Forwarder pool.
+ */
+typedef struct ndn_forwarder_pool {
+  /** Number of shards.
+   */
+  uint8_t shard_cnt;
+
+  /** Number of leading name components deciding the shard.
+   * Names shorter than this use the whole name.
+   */
+  uint8_t prefix_len;
+
+  ndn_forwarder_t shards[NDN_FORWARDER_POOL_MAX_SHARDS];
+
+  ndn_msgqueue_t msgqueues[NDN_FORWARDER_POOL_MAX_SHARDS];
+} ndn_forwarder_pool_t;
+
+/** Get the memory size needed by a pool.
+ *
+ * @param[in] shard_cnt The number of shards.
+ * @param[in] config The capacities of the tables of one shard.
+ * @return The size in bytes.
+ */
+size_t
+ndn_forwarder_pool_memory_size(uint8_t shard_cnt, const ndn_forwarder_config_t* config);
+
+/** Initialize a pool.
+ *
+ * @param[out] self The pool to initialize.
+ * @param[in] shard_cnt The number of shards, at most #NDN_FORWARDER_POOL_MAX_SHARDS.
+ * @param[in] prefix_len The number of leading name components deciding the shard, at least 1.
+ *                       An Interest with CanBePrefix must have at least @c prefix_len components
+ *                       to meet Data with longer names.
+ * @param[in] config The capacities of the tables of one shard.
+ *                   @c memory, if given, is in size of #ndn_forwarder_pool_memory_size.
+ *                   Otherwise, @c alloc is called once for all shards.
+ *                   @c msgqueue is ignored; each shard has its own queue.
+ * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
+ * @retval #NDN_OVERSIZE @c shard_cnt, @c prefix_len or a capacity is out of range.
+ * @retval #NDN_FWD_NO_MEMORY @c alloc failed.
+ */
+int
+ndn_forwarder_pool_init(ndn_forwarder_pool_t* self,
+                        uint8_t shard_cnt,
+                        uint8_t prefix_len,
+                        const ndn_forwarder_config_t* config);
+
+/** Get the shard of a name.
+ *
+ * @param[in] self The pool.
+ * @param[in] name The TLV encoded name.
+ * @param[in] length The length of @c name.
+ * @return The index of the shard. A negative error code if @c name is malformed.
+ */
+int
+ndn_forwarder_pool_shard_of_name(ndn_forwarder_pool_t* self, uint8_t* name, size_t length);
+
+/** Get the shard of an Interest, Data or Nack packet.
+ *
+ * A face thread calls this to choose the worker to hand @c packet to.
+ * @param[in] self The pool.
+ * @param[in] packet The encoded packet.
+ * @param[in] length The length of @c packet.
+ * @return The index of the shard. A negative error code if @c packet is malformed.
+ */
+int
+ndn_forwarder_pool_shard_of_packet(ndn_forwarder_pool_t* self, uint8_t* packet, size_t length);
+
+/** Process event messages of a shard.
+ *
+ * The worker thread of the shard should call this at a fixed interval.
+ * @param[in, out] self The pool.
+ * @param[in] shard The index of the shard.
+ */
+void
+ndn_forwarder_pool_process(ndn_forwarder_pool_t* self, uint8_t shard);
+
+/** Receive a packet from a face.
+ *
+ * The packet is processed by its shard on the calling thread,
+ * which must be the worker thread of that shard.
+ * Face threads use ndn_forwarder_pool_enqueue() instead.
+ * @sa ndn_forwarder_receive
+ */
+int
+ndn_forwarder_pool_receive(ndn_forwarder_pool_t* self,
+                           ndn_face_intf_t* face,
+                           uint8_t* packet,
+                           size_t length);
+
+/** Queue a packet received by a face into the ingress ring of its shard.
+ *
+ * Safe to call from any thread. The shards need an ingress ring.
+ * @sa ndn_fwd_enqueue
+ */
+int
+ndn_forwarder_pool_enqueue(ndn_forwarder_pool_t* self,
+                           ndn_face_intf_t* face,
+                           uint8_t* packet,
+                           size_t length);
+
+/** Register a new face to all shards.
+ *
+ * The face gets the same ID in every shard.
+ * Its @c send and @c send_buf must be thread-safe, as every worker thread calls them
+ * without locking.
+ * @sa ndn_forwarder_register_face
+ */
+int
+ndn_forwarder_pool_register_face(ndn_forwarder_pool_t* self, ndn_face_intf_t* face);
+
+/** Unregister a face from all shards.
+ * @sa ndn_forwarder_unregister_face
+ */
+int
+ndn_forwarder_pool_unregister_face(ndn_forwarder_pool_t* self, ndn_face_intf_t* face);
+
+/** Add a route into the FIB of all shards.
+ * @sa ndn_forwarder_add_route
+ */
+int
+ndn_forwarder_pool_add_route(ndn_forwarder_pool_t* self,
+                             ndn_face_intf_t* face,
+                             uint8_t* prefix,
+                             size_t length);
+
+/** Remove a route from the FIB of all shards.
+ * @sa ndn_forwarder_remove_route
+ */
+int
+ndn_forwarder_pool_remove_route(ndn_forwarder_pool_t* self,
+                                ndn_face_intf_t* face,
+                                uint8_t* prefix,
+                                size_t length);
+
+/** Post a batch of route updates to all shards.
+ *
+ * Safe to call from one control thread while the workers run.
+ * Each worker applies the whole batch in its next ndn_forwarder_pool_process(),
+ * without locking; the batch is done when ndn_route_batch_done() returns true.
+ * @param[in, out] self The pool.
+ * @param[in, out] batch The batch. Its counters are reset.
+ * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
+ * @retval #NDN_FWD_ROUTE_BATCH_BUSY A shard has not taken the previous batch yet.
+ *                                   No shard gets @c batch.
+ * @sa ndn_fwd_post_route_batch
+ */
+int
+ndn_forwarder_pool_post_route_batch(ndn_forwarder_pool_t* self, ndn_route_batch_t* batch);
+
+/** Set the forwarding strategy of a prefix in all shards.
+ *
+ * Each shard keeps its own face measurements.
+ * @sa ndn_forwarder_set_strategy
+ */
+int
+ndn_forwarder_pool_set_strategy(ndn_forwarder_pool_t* self,
+                                uint8_t* prefix,
+                                size_t length,
+                                const ndn_strategy_t* strategy);
+
+/** Register a prefix to all shards.
+ *
+ * @c on_interest may be called from any worker thread.
+ * @sa ndn_forwarder_register_prefix
+ */
+int
+ndn_forwarder_pool_register_prefix(ndn_forwarder_pool_t* self,
+                                   uint8_t* prefix,
+                                   size_t length,
+                                   ndn_on_interest_func on_interest,
+                                   void* userdata);
+
+/** Unregister a prefix from all shards.
+ * @sa ndn_forwarder_unregister_prefix
+ */
+int
+ndn_forwarder_pool_unregister_prefix(ndn_forwarder_pool_t* self, uint8_t* prefix, size_t length);
+
+/** Express an interest through its shard.
+ *
+ * Must be called on the worker thread of the shard of @c interest.
+ * @sa ndn_forwarder_express_interest
+ */
+int
+ndn_forwarder_pool_express_interest(ndn_forwarder_pool_t* self,
+                                    uint8_t* interest,
+                                    size_t length,
+                                    ndn_on_data_func on_data,
+                                    ndn_on_timeout_func on_timeout,
+                                    void* userdata);
+
+/** Express an interest with a Nack callback through its shard.
+ *
+ * Must be called on the worker thread of the shard of @c interest.
+ * @sa ndn_forwarder_express_interest_with_nack
+ */
+int
+ndn_forwarder_pool_express_interest_with_nack(ndn_forwarder_pool_t* self,
+                                              uint8_t* interest,
+                                              size_t length,
+                                              ndn_on_data_func on_data,
+                                              ndn_on_timeout_func on_timeout,
+                                              ndn_on_nack_func on_nack,
+                                              void* userdata);
+
+/** Produce a data packet through its shard.
+ *
+ * Must be called on the worker thread of the shard of @c data.
+ * @sa ndn_forwarder_put_data
+ */
+int
+ndn_forwarder_pool_put_data(ndn_forwarder_pool_t* self, uint8_t* data, size_t length);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FORWARDER_FORWARDER_POOL_H
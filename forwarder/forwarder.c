@@ -9,74 +9,105 @@
 #include "forwarder.h"
 #include "pit.h"
 #include "fib.h"
+#include "cs.h"
 #include "face-table.h"
+#include "strategy.h"
+#include "ingress-ring.h"
+#include "dead-nonce.h"
 #include "../ndn-constants.h"
 #include "../ndn-error-code.h"
 #include "../encode/tlv.h"
 
-#define NDN_FORWARDER_RESERVE_SIZE(nametree_size, facetab_size, fib_size, pit_size) \
-  (NDN_NAMETREE_RESERVE_SIZE(nametree_size) + \
-   NDN_FACE_TABLE_RESERVE_SIZE(facetab_size) + \
-   NDN_FIB_RESERVE_SIZE(fib_size) + \
-   NDN_PIT_RESERVE_SIZE(pit_size))
+/** Round a table's size up so that the next table is aligned to a pointer.
+ */
+#define NDN_FORWARDER_ALIGN(size) \
+  (((size) + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*))
+
+#define NDN_FORWARDER_RESERVE_SIZE(nametree_size, facetab_size, fib_size, pit_size, cs_size) \
+  (NDN_FORWARDER_ALIGN(NDN_NAMETREE_RESERVE_SIZE(nametree_size)) + \
+   NDN_FORWARDER_ALIGN(NDN_FACE_TABLE_RESERVE_SIZE(facetab_size)) + \
+   NDN_FORWARDER_ALIGN(NDN_FIB_RESERVE_SIZE(fib_size)) + \
+   NDN_FORWARDER_ALIGN(NDN_PIT_RESERVE_SIZE(pit_size)) + \
+   NDN_FORWARDER_ALIGN(NDN_CS_RESERVE_SIZE(cs_size)))
 
 #define NDN_FORWARDER_DEFAULT_SIZE \
-  NDN_FORWARDER_RESERVE_SIZE(NDN_NAMETREE_MAX_SIZE, \
-                             NDN_FACE_TABLE_MAX_SIZE, \
-                             NDN_FIB_MAX_SIZE, \
-                             NDN_PIT_MAX_SIZE)
+  (NDN_FORWARDER_RESERVE_SIZE(NDN_NAMETREE_MAX_SIZE, \
+                              NDN_FACE_TABLE_MAX_SIZE, \
+                              NDN_FIB_MAX_SIZE, \
+                              NDN_PIT_MAX_SIZE, \
+                              NDN_CS_MAX_SIZE) + \
+   NDN_FORWARDER_ALIGN(NDN_DEAD_NONCE_RESERVE_SIZE(NDN_DEAD_NONCE_LIST_SIZE)))
 
 /**
- * NDN-Lite forwarder.
- * We will support content store in future versions.
- * The NDN forwarder is a singleton in an application.
+ * The memory used by ndn_forwarder_init(), aligned to a pointer.
  */
-typedef struct ndn_forwarder {
-  ndn_nametree_t* nametree;
-  ndn_face_table_t* facetab;
-
-  /**
-   * The forwarding information base (FIB).
-   */
-  ndn_fib_t* fib;
-  /**
-   * The pending Interest table (PIT).
-   */
-  ndn_pit_t* pit;
-
-  uint8_t memory[NDN_FORWARDER_DEFAULT_SIZE];
-} ndn_forwarder_t;
+static void* forwarder_memory[NDN_FORWARDER_DEFAULT_SIZE / sizeof(void*)];
 
+/**
+ * The default forwarder instance, used by the ndn_forwarder_* functions.
+ */
 static ndn_forwarder_t forwarder;
 
 // face_id is optional
 static int
-fwd_on_incoming_interest(uint8_t* interest,
+fwd_on_incoming_interest(ndn_forwarder_t* self,
+                         uint8_t* interest,
                          size_t length,
                          interest_options_t* options,
-                         uint8_t* name,
-                         size_t name_len,
+                         const ndn_parsed_name_t* name,
                          ndn_table_id_t face_id);
 
 static int
-fwd_on_outgoing_interest(uint8_t* interest,
+fwd_on_outgoing_interest(ndn_forwarder_t* self,
+                         uint8_t* interest,
                          size_t length,
-                         uint8_t* name,
-                         size_t name_len,
+                         const ndn_parsed_name_t* name,
                          ndn_pit_entry_t* entry,
                          ndn_table_id_t face_id);
 
 static int
-fwd_data_pipeline(uint8_t* data,
+fwd_data_pipeline(ndn_forwarder_t* self,
+                  uint8_t* data,
+                  size_t length,
+                  const ndn_parsed_name_t* name,
+                  ndn_table_id_t face_id);
+
+static int
+fwd_nack_pipeline(ndn_forwarder_t* self,
+                  uint8_t* interest,
                   size_t length,
-                  uint8_t* name,
-                  size_t name_len,
+                  const ndn_parsed_name_t* name,
+                  uint32_t reason,
                   ndn_table_id_t face_id);
 
-static ndn_bitset_t
-fwd_multicast(uint8_t* packet,
+static ndn_faceset_t
+fwd_send_interest(ndn_forwarder_t* self,
+                  uint8_t* interest,
+                  size_t length,
+                  ndn_pit_entry_t* entry,
+                  ndn_fib_entry_t* fib_entry,
+                  const ndn_faceset_t* exclude,
+                  bool retx);
+
+static void
+fwd_send_nack(ndn_forwarder_t* self,
+              ndn_table_id_t face_id,
+              uint32_t reason,
+              uint8_t* interest,
+              size_t length);
+
+static void
+fwd_reject_interest(ndn_forwarder_t* self,
+                    ndn_pit_entry_t* entry,
+                    uint32_t reason,
+                    uint8_t* interest,
+                    size_t length);
+
+static ndn_faceset_t
+fwd_multicast(ndn_forwarder_t* self,
+              uint8_t* packet,
               size_t length,
-              ndn_bitset_t out_faces,
+              ndn_faceset_t out_faces,
               ndn_table_id_t in_face);
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -84,129 +115,415 @@ fwd_multicast(uint8_t* packet,
 void
 ndn_forwarder_init(void)
 {
-  uint8_t* ptr = (uint8_t*)forwarder.memory;
-  ndn_msgqueue_init();
+  ndn_forwarder_config_t config = {
+    .nametree_size = NDN_NAMETREE_MAX_SIZE,
+    .facetab_size = NDN_FACE_TABLE_MAX_SIZE,
+    .fib_size = NDN_FIB_MAX_SIZE,
+    .pit_size = NDN_PIT_MAX_SIZE,
+    .cs_size = NDN_CS_MAX_SIZE,
+    .memory = forwarder_memory,
+    .alloc = NULL,
+    .msgqueue = NULL,
+    .ingress_size = 0,
+    .ingress_packet_size = 0,
+    .pktbuf_count = 0,
+    .pktbuf_size = 0,
+    .measurements_size = 0,
+    .dead_nonce_size = NDN_DEAD_NONCE_LIST_SIZE,
+  };
+  ndn_forwarder_init_with_config(&config);
+}
+
+size_t
+ndn_forwarder_memory_size(const ndn_forwarder_config_t* config)
+{
+  size_t ret = NDN_FORWARDER_RESERVE_SIZE(config->nametree_size,
+                                          config->facetab_size,
+                                          config->fib_size,
+                                          config->pit_size,
+                                          config->cs_size);
+  if(config->ingress_size > 0){
+    ret += NDN_FORWARDER_ALIGN(NDN_INGRESS_RING_RESERVE_SIZE(config->ingress_size,
+                                                             config->ingress_packet_size));
+  }
+  if(config->pktbuf_count > 0){
+    ret += NDN_FORWARDER_ALIGN(NDN_PKTBUF_POOL_RESERVE_SIZE(config->pktbuf_size,
+                                                            config->pktbuf_count));
+  }
+  if(config->measurements_size > 0){
+    ret += NDN_FORWARDER_ALIGN(NDN_MEASUREMENTS_RESERVE_SIZE(config->measurements_size));
+  }
+  if(config->dead_nonce_size > 0){
+    ret += NDN_FORWARDER_ALIGN(NDN_DEAD_NONCE_RESERVE_SIZE(config->dead_nonce_size));
+  }
+  return ret;
+}
+
+int
+ndn_forwarder_check_config(const ndn_forwarder_config_t* config)
+{
+  if(config == NULL || config->msgqueue == NULL ||
+     (config->memory == NULL && config->alloc == NULL))
+    return NDN_INVALID_POINTER;
+  if(config->nametree_size < 2 || config->nametree_size == NDN_INVALID_ID ||
+     config->facetab_size > NDN_FACESET_CAPACITY ||
+     config->fib_size == NDN_INVALID_ID ||
+     config->pit_size == NDN_INVALID_ID ||
+     config->cs_size == NDN_INVALID_ID ||
+     config->measurements_size == NDN_INVALID_ID ||
+     (config->ingress_size & (config->ingress_size - 1)) != 0 ||
+     (config->dead_nonce_size & (config->dead_nonce_size - 1)) != 0 ||
+     (config->dead_nonce_size > 0 && config->dead_nonce_size < NDN_DEAD_NONCE_BUCKET_SLOTS))
+    return NDN_OVERSIZE;
+  return NDN_SUCCESS;
+}
+
+int
+ndn_fwd_init(ndn_forwarder_t* self, const ndn_forwarder_config_t* config)
+{
+  uint8_t* ptr;
+  int ret;
+
+  if(self == NULL)
+    return NDN_INVALID_POINTER;
+  ret = ndn_forwarder_check_config(config);
+  if(ret != NDN_SUCCESS)
+    return ret;
+
+  ptr = (uint8_t*)config->memory;
+  if(ptr == NULL){
+    ptr = (uint8_t*)config->alloc(ndn_forwarder_memory_size(config));
+    if(ptr == NULL)
+      return NDN_FWD_NO_MEMORY;
+  }
+  self->memory = ptr;
+  self->msgqueue = config->msgqueue;
+  ndn_msgq_init(self->msgqueue);
+
+  atomic_init(&self->route_batch, NULL);
+
+  ndn_nametree_init(ptr, config->nametree_size);
+  self->nametree = (ndn_nametree_t*)ptr;
+  ptr += NDN_FORWARDER_ALIGN(NDN_NAMETREE_RESERVE_SIZE(config->nametree_size));
+
+  ndn_facetab_init(ptr, config->facetab_size);
+  self->facetab = (ndn_face_table_t*)ptr;
+  ptr += NDN_FORWARDER_ALIGN(NDN_FACE_TABLE_RESERVE_SIZE(config->facetab_size));
+
+  ndn_fib_init(ptr, config->fib_size, self->nametree);
+  self->fib = (ndn_fib_t*)ptr;
+  self->fib->facetab = self->facetab;
+  ptr += NDN_FORWARDER_ALIGN(NDN_FIB_RESERVE_SIZE(config->fib_size));
+
+  ndn_pit_init(ptr, config->pit_size, self->nametree, self->msgqueue);
+  self->pit = (ndn_pit_t*)ptr;
+  self->pit->measures = self->facetab->measures;
+  self->pit->facetab = self->facetab;
+  ptr += NDN_FORWARDER_ALIGN(NDN_PIT_RESERVE_SIZE(config->pit_size));
+
+  ndn_cs_init(ptr, config->cs_size, self->nametree);
+  self->cs = (ndn_cs_t*)ptr;
+  ptr += NDN_FORWARDER_ALIGN(NDN_CS_RESERVE_SIZE(config->cs_size));
+
+  if(config->ingress_size > 0){
+    ndn_ingress_ring_init(ptr, config->ingress_size, config->ingress_packet_size);
+    self->ingress = (ndn_ingress_ring_t*)ptr;
+    ptr += NDN_FORWARDER_ALIGN(NDN_INGRESS_RING_RESERVE_SIZE(config->ingress_size,
+                                                             config->ingress_packet_size));
+  }else{
+    self->ingress = NULL;
+  }
 
-  ndn_nametree_init(ptr, NDN_NAMETREE_MAX_SIZE);
-  forwarder.nametree = (ndn_nametree_t*)ptr;
-  ptr += NDN_NAMETREE_RESERVE_SIZE(NDN_NAMETREE_MAX_SIZE);
+  if(config->pktbuf_count > 0){
+    ndn_pktbuf_pool_init(ptr, config->pktbuf_size, config->pktbuf_count);
+    self->pktbufs = (ndn_pktbuf_pool_t*)ptr;
+    ptr += NDN_FORWARDER_ALIGN(NDN_PKTBUF_POOL_RESERVE_SIZE(config->pktbuf_size,
+                                                            config->pktbuf_count));
+  }else{
+    self->pktbufs = NULL;
+  }
 
-  ndn_facetab_init(ptr, NDN_FACE_TABLE_MAX_SIZE);
-  forwarder.facetab = (ndn_face_table_t*)ptr;
-  ptr += NDN_FACE_TABLE_RESERVE_SIZE(NDN_FACE_TABLE_MAX_SIZE);
+  if(config->measurements_size > 0){
+    ndn_measurements_init(ptr, config->measurements_size, self->nametree);
+    self->measurements = (ndn_measurements_t*)ptr;
+    self->measurements->facetab = self->facetab;
+    ptr += NDN_FORWARDER_ALIGN(NDN_MEASUREMENTS_RESERVE_SIZE(config->measurements_size));
+  }else{
+    self->measurements = NULL;
+  }
+  self->pit->measurements = self->measurements;
 
-  ndn_fib_init(ptr, NDN_FIB_MAX_SIZE, forwarder.nametree);
-  forwarder.fib = (ndn_fib_t*)ptr;
-  ptr += NDN_FIB_RESERVE_SIZE(NDN_FIB_MAX_SIZE);
+  if(config->dead_nonce_size > 0){
+    ndn_dead_nonce_init(ptr, config->dead_nonce_size, NDN_DEAD_NONCE_LIFETIME);
+    self->dead_nonce = (ndn_dead_nonce_t*)ptr;
+    ptr += NDN_FORWARDER_ALIGN(NDN_DEAD_NONCE_RESERVE_SIZE(config->dead_nonce_size));
+  }else{
+    self->dead_nonce = NULL;
+  }
 
-  ndn_pit_init(ptr, NDN_PIT_MAX_SIZE, forwarder.nametree);
-  forwarder.pit = (ndn_pit_t*)ptr;
-  ptr += NDN_PIT_RESERVE_SIZE(NDN_PIT_MAX_SIZE);
+  return NDN_SUCCESS;
 }
 
 void
-ndn_forwarder_process(void){
-  ndn_msgqueue_process();
+ndn_fwd_process(ndn_forwarder_t* self){
+  ndn_ingress_slot_t* slot;
+  ndn_route_batch_t* batch;
+  size_t cnt;
+  int ret;
+
+  // Applied before the ring, so packets queued after the post see the new routes
+  batch = atomic_exchange_explicit(&self->route_batch, NULL, memory_order_acquire);
+  if(batch != NULL){
+    ret = ndn_fwd_apply_route_batch(self, batch->updates, batch->count);
+    cnt = (ret >= 0 ? batch->count - (size_t)ret : batch->count);
+    atomic_fetch_add_explicit(&batch->failures, cnt, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&batch->pending, 1, memory_order_release);
+  }
+  if(self->ingress != NULL){
+    // Bounded so that busy faces cannot starve the timers
+    for(cnt = 0; cnt < self->ingress->capacity; cnt ++){
+      slot = ndn_ingress_ring_front(self->ingress);
+      if(slot == NULL)
+        break;
+      ndn_fwd_receive_parsed(self, slot->face, &slot->parsed);
+      ndn_ingress_ring_pop(self->ingress);
+    }
+  }
+  ndn_msgq_process(self->msgqueue);
 }
 
 int
-ndn_forwarder_register_face(ndn_face_intf_t* face)
+ndn_fwd_enqueue(ndn_forwarder_t* self, ndn_face_intf_t* face, const uint8_t* packet, size_t length)
+{
+  ndn_parsed_packet_t parsed;
+  int ret;
+
+  if(self->ingress == NULL || packet == NULL)
+    return NDN_INVALID_POINTER;
+  // Parsed on the face thread, which only reads the packet
+  ret = ndn_parsed_packet_init(&parsed, (uint8_t*)packet, length);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  return ndn_ingress_ring_push(self->ingress, face, packet, length, &parsed);
+}
+
+size_t
+ndn_fwd_ingress_drops(ndn_forwarder_t* self)
+{
+  if(self->ingress == NULL)
+    return 0;
+  return ndn_ingress_ring_drops(self->ingress);
+}
+
+int
+ndn_fwd_register_face(ndn_forwarder_t* self, ndn_face_intf_t* face)
 {
   if(face == NULL)
     return NDN_INVALID_POINTER;
   if(face->face_id != NDN_INVALID_ID)
     return NDN_FWD_NO_EFFECT;
-  face->face_id = ndn_facetab_register(forwarder.facetab, face);
+  face->face_id = ndn_facetab_register(self->facetab, face);
   if(face->face_id == NDN_INVALID_ID)
     return NDN_FWD_FACE_TABLE_FULL;
   return NDN_SUCCESS;
 }
 
 int
-ndn_forwarder_unregister_face(ndn_face_intf_t* face)
+ndn_fwd_unregister_face(ndn_forwarder_t* self, ndn_face_intf_t* face)
 {
   if(face == NULL)
     return NDN_INVALID_POINTER;
   if(face->face_id == NDN_INVALID_ID)
     return NDN_FWD_NO_EFFECT;
-  if(face->face_id >= forwarder.facetab->capacity)
+  if(face->face_id >= self->facetab->capacity)
     return NDN_FWD_INVALID_FACE;
-  ndn_fib_unregister_face(forwarder.fib, face->face_id);
-  ndn_pit_unregister_face(forwarder.pit, face->face_id);
-  ndn_facetab_unregister(forwarder.facetab, face->face_id);
+  ndn_facetab_unregister(self->facetab, face->face_id);
   face->face_id = NDN_INVALID_ID;
   return NDN_SUCCESS;
 }
 
+/** Parse a prefix given by the application.
+ */
+static int
+fwd_parse_prefix(ndn_parsed_name_t* parsed, uint8_t* prefix, size_t length)
+{
+  int ret = tlv_check_type_length(prefix, length, TLV_Name);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  return ndn_parsed_name_init(parsed, prefix, length);
+}
+
 int
-ndn_forwarder_add_route(ndn_face_intf_t* face, uint8_t* prefix, size_t length){
+ndn_fwd_add_route(ndn_forwarder_t* self, ndn_face_intf_t* face, uint8_t* prefix, size_t length){
+  ndn_parsed_name_t parsed;
   int ret;
   ndn_fib_entry_t* fib_entry;
 
   if(face == NULL)
     return NDN_INVALID_POINTER;
-  if(face->face_id >= forwarder.facetab->capacity)
+  if(face->face_id >= self->facetab->capacity)
     return NDN_FWD_INVALID_FACE;
-  ret = tlv_check_type_length(prefix, length, TLV_Name);
+  ret = fwd_parse_prefix(&parsed, prefix, length);
   if(ret != NDN_SUCCESS)
     return ret;
 
-  fib_entry = ndn_fib_find_or_insert(forwarder.fib, prefix, length);
+  fib_entry = ndn_fib_find_or_insert(self->fib, &parsed);
   if (fib_entry == NULL)
     return NDN_FWD_FIB_FULL;
-  fib_entry->nexthop = bitset_set(fib_entry->nexthop, face->face_id);
+  faceset_set(&fib_entry->nexthop, face->face_id);
   return NDN_SUCCESS;
 }
 
 int
-ndn_forwarder_remove_route(ndn_face_intf_t* face, uint8_t* prefix, size_t length)
+ndn_fwd_remove_route(ndn_forwarder_t* self, ndn_face_intf_t* face, uint8_t* prefix, size_t length)
 {
+  ndn_parsed_name_t parsed;
   int ret;
 
   if(face == NULL)
     return NDN_INVALID_POINTER;
-  if(face->face_id >= forwarder.facetab->capacity)
+  if(face->face_id >= self->facetab->capacity)
     return NDN_FWD_INVALID_FACE;
-  ret = tlv_check_type_length(prefix, length, TLV_Name);
+  ret = fwd_parse_prefix(&parsed, prefix, length);
   if(ret != NDN_SUCCESS)
     return ret;
 
-  ndn_fib_entry_t* fib_entry = ndn_fib_find(forwarder.fib, prefix, length);
+  ndn_fib_entry_t* fib_entry = ndn_fib_find(self->fib, &parsed);
   if (fib_entry == NULL)
     return NDN_FWD_NO_EFFECT;
-  fib_entry->nexthop = bitset_unset(fib_entry->nexthop, face->face_id);
-  ndn_fib_remove_entry_if_empty(forwarder.fib, fib_entry);
+  faceset_unset(&fib_entry->nexthop, face->face_id);
+  ndn_fib_remove_entry_if_empty(self->fib, fib_entry);
   return NDN_SUCCESS;
 }
 
 int
-ndn_forwarder_remove_all_routes(uint8_t* prefix, size_t length)
+ndn_fwd_remove_all_routes(ndn_forwarder_t* self, uint8_t* prefix, size_t length)
 {
-  int ret = tlv_check_type_length(prefix, length, TLV_Name);
+  ndn_parsed_name_t parsed;
+  int ret = fwd_parse_prefix(&parsed, prefix, length);
   if(ret != NDN_SUCCESS)
     return ret;
 
-  ndn_fib_entry_t* fib_entry = ndn_fib_find(forwarder.fib, prefix, length);
+  ndn_fib_entry_t* fib_entry = ndn_fib_find(self->fib, &parsed);
   if (fib_entry == NULL)
     return NDN_FWD_NO_EFFECT;
-  fib_entry->nexthop = 0;
-  ndn_fib_remove_entry_if_empty(forwarder.fib, fib_entry);
+  faceset_clear(&fib_entry->nexthop);
+  ndn_fib_remove_entry_if_empty(self->fib, fib_entry);
   return NDN_SUCCESS;
 }
 
 int
-ndn_forwarder_register_prefix(uint8_t* prefix,
-                              size_t length,
-                              ndn_on_interest_func on_interest,
-                              void* userdata)
+ndn_fwd_apply_route_batch(ndn_forwarder_t* self, const ndn_route_update_t* updates, size_t count)
 {
-  int ret = tlv_check_type_length(prefix, length, TLV_Name);
+  const ndn_route_update_t* update;
+  int ret, done = 0;
+  size_t i;
+
+  if(updates == NULL)
+    return NDN_INVALID_POINTER;
+  for(i = 0; i < count; i ++){
+    update = &updates[i];
+    switch(update->op){
+    case NDN_ROUTE_ADD:
+      ret = ndn_fwd_add_route(self, update->face, update->prefix, update->length);
+      break;
+    case NDN_ROUTE_REMOVE:
+      ret = ndn_fwd_remove_route(self, update->face, update->prefix, update->length);
+      break;
+    case NDN_ROUTE_REMOVE_ALL:
+      ret = ndn_fwd_remove_all_routes(self, update->prefix, update->length);
+      break;
+    default:
+      ret = NDN_FWD_NO_EFFECT;
+      break;
+    }
+    if(ret == NDN_SUCCESS)
+      done ++;
+  }
+  return done;
+}
+
+int
+ndn_fwd_post_route_batch(ndn_forwarder_t* self, ndn_route_batch_t* batch)
+{
+  ndn_route_batch_t* expected = NULL;
+
+  if(batch == NULL || (batch->updates == NULL && batch->count > 0))
+    return NDN_INVALID_POINTER;
+  // Only the control thread stores a batch, so the slot cannot be taken in between
+  if(atomic_load_explicit(&self->route_batch, memory_order_relaxed) != NULL)
+    return NDN_FWD_ROUTE_BATCH_BUSY;
+  atomic_store_explicit(&batch->pending, 1, memory_order_relaxed);
+  atomic_store_explicit(&batch->failures, 0, memory_order_relaxed);
+  if(!atomic_compare_exchange_strong_explicit(&self->route_batch, &expected, batch,
+                                              memory_order_release, memory_order_relaxed))
+    return NDN_FWD_ROUTE_BATCH_BUSY;
+  return NDN_SUCCESS;
+}
+
+bool
+ndn_route_batch_done(ndn_route_batch_t* batch)
+{
+  return atomic_load_explicit(&batch->pending, memory_order_acquire) == 0;
+}
+
+int
+ndn_fwd_set_strategy(ndn_forwarder_t* self,
+                     uint8_t* prefix,
+                     size_t length,
+                     const ndn_strategy_t* strategy)
+{
+  ndn_parsed_name_t parsed;
+  int ret = fwd_parse_prefix(&parsed, prefix, length);
+  if(ret != NDN_SUCCESS)
+    return ret;
+
+  ndn_fib_entry_t* fib_entry = ndn_fib_find(self->fib, &parsed);
+  if (fib_entry == NULL)
+    return NDN_FWD_NO_ROUTE;
+  fib_entry->strategy = strategy;
+  return NDN_SUCCESS;
+}
+
+const ndn_measurements_entry_t*
+ndn_fwd_get_measurements(ndn_forwarder_t* self, uint8_t* prefix, size_t length, ndn_face_intf_t* face)
+{
+  ndn_parsed_name_t parsed;
+  ndn_fib_entry_t* fib_entry;
+
+  if(self->measurements == NULL || face == NULL || face->face_id == NDN_INVALID_ID)
+    return NULL;
+  if(fwd_parse_prefix(&parsed, prefix, length) != NDN_SUCCESS)
+    return NULL;
+  fib_entry = ndn_fib_find(self->fib, &parsed);
+  if(fib_entry == NULL)
+    return NULL;
+  return ndn_measurements_find(self->measurements, fib_entry->nametree_id, face->face_id);
+}
+
+ndn_face_measure_t*
+ndn_fwd_get_face_measure(ndn_forwarder_t* self, ndn_face_intf_t* face)
+{
+  if(face == NULL || face->face_id >= self->facetab->capacity)
+    return NULL;
+  return &self->facetab->measures[face->face_id];
+}
+
+int
+ndn_fwd_register_prefix(ndn_forwarder_t* self,
+                        uint8_t* prefix,
+                        size_t length,
+                        ndn_on_interest_func on_interest,
+                        void* userdata)
+{
+  ndn_parsed_name_t parsed;
+  int ret = fwd_parse_prefix(&parsed, prefix, length);
   if(ret != NDN_SUCCESS)
     return ret;
   if (on_interest == NULL)
     return NDN_INVALID_POINTER;
 
-  ndn_fib_entry_t* fib_entry = ndn_fib_find_or_insert(forwarder.fib, prefix, length);
+  ndn_fib_entry_t* fib_entry = ndn_fib_find_or_insert(self->fib, &parsed);
   if (fib_entry == NULL)
     return NDN_FWD_FIB_FULL;
   fib_entry->on_interest = on_interest;
@@ -215,122 +532,398 @@ ndn_forwarder_register_prefix(uint8_t* prefix,
 }
 
 int
-ndn_forwarder_unregister_prefix(uint8_t* prefix, size_t length)
+ndn_fwd_unregister_prefix(ndn_forwarder_t* self, uint8_t* prefix, size_t length)
 {
-  int ret = tlv_check_type_length(prefix, length, TLV_Name);
+  ndn_parsed_name_t parsed;
+  int ret = fwd_parse_prefix(&parsed, prefix, length);
   if(ret != NDN_SUCCESS)
     return ret;
 
-  ndn_fib_entry_t* fib_entry = ndn_fib_find(forwarder.fib, prefix, length);
+  ndn_fib_entry_t* fib_entry = ndn_fib_find(self->fib, &parsed);
   if (fib_entry == NULL)
     return NDN_FWD_NO_EFFECT;
   fib_entry->on_interest = NULL;
   fib_entry->userdata = NULL;
-  ndn_fib_remove_entry_if_empty(forwarder.fib, fib_entry);
+  ndn_fib_remove_entry_if_empty(self->fib, fib_entry);
   return NDN_SUCCESS;
 }
 
 int
-ndn_forwarder_express_interest(uint8_t* interest,
-                               size_t length,
-                               ndn_on_data_func on_data,
-                               ndn_on_timeout_func on_timeout,
-                               void* userdata)
+ndn_fwd_express_interest(ndn_forwarder_t* self,
+                         uint8_t* interest,
+                         size_t length,
+                         ndn_on_data_func on_data,
+                         ndn_on_timeout_func on_timeout,
+                         void* userdata)
+{
+  return ndn_fwd_express_interest_with_nack(self, interest, length, on_data, on_timeout, NULL,
+                                            userdata);
+}
+
+static int
+fwd_express_interest(ndn_forwarder_t* self,
+                     uint8_t* interest,
+                     size_t length,
+                     interest_options_t* options,
+                     ndn_parsed_name_t* name,
+                     ndn_on_data_func on_data,
+                     ndn_on_timeout_func on_timeout,
+                     ndn_on_nack_func on_nack,
+                     void* userdata)
 {
-  int ret;
-  interest_options_t options;
-  uint8_t *name;
-  size_t name_len;
   ndn_pit_entry_t* pit_entry;
+  ndn_cs_entry_t* cs_entry;
 
-  if(interest == NULL || on_data == NULL)
-    return NDN_INVALID_POINTER;
+  // So the Interest is dropped if it comes back
+  if(self->dead_nonce != NULL && options->nonce != 0){
+    ndn_dead_nonce_test_and_add(self->dead_nonce, name->hashes[name->count], options->nonce, ndn_time_now_ms());
+  }
 
-  ret = tlv_interest_get_header(interest, length, &options, &name, &name_len);
-  if(ret != NDN_SUCCESS)
-    return ret;
+  cs_entry = ndn_cs_match(self->cs, name, options);
+  if(cs_entry != NULL){
+    on_data(cs_entry->data, cs_entry->length, userdata);
+    return NDN_SUCCESS;
+  }
 
-  pit_entry = ndn_pit_find_or_insert(forwarder.pit, name, name_len);
+  pit_entry = ndn_pit_find_or_insert(self->pit, name);
   if (pit_entry == NULL)
     return NDN_FWD_PIT_FULL;
-  pit_entry->options = options;
+  pit_entry->options = *options;
   pit_entry->on_data = on_data;
   pit_entry->on_timeout = on_timeout;
+  pit_entry->on_nack = on_nack;
   pit_entry->userdata = userdata;
 
   pit_entry->last_time = pit_entry->express_time = ndn_time_now_ms();
+  ndn_pit_update_timer(self->pit, pit_entry);
 
-  return fwd_on_outgoing_interest(interest, length, name, name_len, pit_entry, NDN_INVALID_ID);
+  return fwd_on_outgoing_interest(self, interest, length, name, pit_entry, NDN_INVALID_ID);
 }
 
 int
-ndn_forwarder_put_data(uint8_t* data, size_t length)
+ndn_fwd_express_interest_with_nack(ndn_forwarder_t* self,
+                                   uint8_t* interest,
+                                   size_t length,
+                                   ndn_on_data_func on_data,
+                                   ndn_on_timeout_func on_timeout,
+                                   ndn_on_nack_func on_nack,
+                                   void* userdata)
+{
+  int ret;
+  interest_options_t options;
+  uint8_t *name_ptr;
+  size_t name_len;
+  ndn_parsed_name_t name;
+
+  if(interest == NULL || on_data == NULL)
+    return NDN_INVALID_POINTER;
+
+  ret = tlv_interest_get_header(interest, length, &options, &name_ptr, &name_len);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  ret = ndn_parsed_name_init(&name, name_ptr, length - (name_ptr - interest));
+  if(ret != NDN_SUCCESS)
+    return ret;
+
+  return fwd_express_interest(self, interest, length, &options, &name,
+                              on_data, on_timeout, on_nack, userdata);
+}
+
+int
+ndn_fwd_express_interest_parsed(ndn_forwarder_t* self,
+                                ndn_parsed_packet_t* interest,
+                                ndn_on_data_func on_data,
+                                ndn_on_timeout_func on_timeout,
+                                ndn_on_nack_func on_nack,
+                                void* userdata)
+{
+  if(interest == NULL || on_data == NULL)
+    return NDN_INVALID_POINTER;
+  if(interest->type != TLV_Interest)
+    return NDN_WRONG_TLV_TYPE;
+  return fwd_express_interest(self, interest->packet, interest->length, &interest->options,
+                              &interest->name, on_data, on_timeout, on_nack, userdata);
+}
+
+int
+ndn_fwd_put_data(ndn_forwarder_t* self, uint8_t* data, size_t length)
 {
   int ret;
   uint8_t *name;
   size_t name_len;
+  ndn_parsed_name_t parsed;
 
   if(data == NULL)
     return NDN_INVALID_POINTER;
   ret = tlv_data_get_name(data, length, &name, &name_len);
+  if(ret != NDN_SUCCESS)
+    return ret;
+  ret = ndn_parsed_name_init(&parsed, name, length - (name - data));
   if(ret != NDN_SUCCESS)
     return ret;
 
-  return fwd_data_pipeline(data, length, name, name_len, NDN_INVALID_ID);
+  return fwd_data_pipeline(self, data, length, &parsed, NDN_INVALID_ID);
 }
 
 int
-ndn_forwarder_receive(ndn_face_intf_t* face, uint8_t* packet, size_t length)
+ndn_fwd_put_data_parsed(ndn_forwarder_t* self, ndn_parsed_packet_t* data)
+{
+  if(data == NULL)
+    return NDN_INVALID_POINTER;
+  if(data->type != TLV_Data)
+    return NDN_WRONG_TLV_TYPE;
+  return fwd_data_pipeline(self, data->packet, data->length, &data->name, NDN_INVALID_ID);
+}
+
+int
+ndn_fwd_receive_parsed(ndn_forwarder_t* self, ndn_face_intf_t* face, ndn_parsed_packet_t* parsed)
 {
-  uint32_t type, val_len;
-  uint8_t* buf;
-  uint8_t *name;
-  size_t name_len;
-  interest_options_t options;
-  int ret;
   ndn_table_id_t face_id = (face ? face->face_id : NDN_INVALID_ID);
 
-  if (packet == NULL)
+  if (parsed->type == TLV_Interest)
+    return fwd_on_incoming_interest(self, parsed->packet, parsed->length, &parsed->options,
+                                    &parsed->name, face_id);
+  else if (parsed->type == TLV_LpNack)
+    return fwd_nack_pipeline(self, parsed->packet, parsed->length, &parsed->name,
+                             parsed->reason, face_id);
+  else
+    return fwd_data_pipeline(self, parsed->packet, parsed->length, &parsed->name, face_id);
+}
+
+int
+ndn_fwd_receive(ndn_forwarder_t* self, ndn_face_intf_t* face, uint8_t* packet, size_t length)
+{
+  ndn_parsed_packet_t parsed;
+  int ret;
+
+  ret = ndn_parsed_packet_init(&parsed, packet, length);
+  if (ret != NDN_SUCCESS)
+    return ret;
+  return ndn_fwd_receive_parsed(self, face, &parsed);
+}
+
+int
+ndn_fwd_receive_batch(ndn_forwarder_t* self,
+                      ndn_face_intf_t* face,
+                      uint8_t* packets[],
+                      size_t lengths[],
+                      size_t count)
+{
+  ndn_parsed_packet_t batch[NDN_FORWARDER_BATCH_SIZE];
+  bool parsed[NDN_FORWARDER_BATCH_SIZE];
+  size_t base, i, n;
+  int done = 0;
+
+  if (packets == NULL || lengths == NULL)
     return NDN_INVALID_POINTER;
 
-  buf = tlv_get_type_length(packet, length, &type, &val_len);
-  if (val_len != length - (buf - packet))
-    return NDN_WRONG_TLV_LENGTH;
+  for (base = 0; base < count; base += n) {
+    n = count - base;
+    if (n > NDN_FORWARDER_BATCH_SIZE)
+      n = NDN_FORWARDER_BATCH_SIZE;
+
+    // Parse all headers, and fetch the name tree for all names before any lookup
+    for (i = 0; i < n; i ++) {
+      parsed[i] = (ndn_parsed_packet_init(&batch[i], packets[base + i],
+                                          lengths[base + i]) == NDN_SUCCESS);
+      if (parsed[i])
+        ndn_nametree_prefetch(self->nametree, &batch[i].name);
+    }
 
-  if (type == TLV_Interest) {
-    ret = tlv_interest_get_header(packet, length, &options, &name, &name_len);
-    if (ret != NDN_SUCCESS)
-      return ret;
-    return fwd_on_incoming_interest(packet, length, &options, name, name_len, face_id);
-  }
-  else if(type == TLV_Data) {
-    ret = tlv_data_get_name(packet, length, &name, &name_len);
-    if (ret != NDN_SUCCESS)
-      return ret;
-    return fwd_data_pipeline(packet, length, name, name_len, face_id);
-  }
-  else {
-    return NDN_WRONG_TLV_TYPE;
+    // Then in arrival order, so no packet overtakes another of the same face
+    for (i = 0; i < n; i ++) {
+      if (parsed[i] && ndn_fwd_receive_parsed(self, face, &batch[i]) == NDN_SUCCESS)
+        done ++;
+    }
   }
+  return done;
+}
+
+ndn_forwarder_t*
+ndn_forwarder_get_default(void)
+{
+  return &forwarder;
+}
+
+int
+ndn_forwarder_init_with_config(const ndn_forwarder_config_t* config)
+{
+  ndn_forwarder_config_t default_config;
+
+  if(config == NULL)
+    return NDN_INVALID_POINTER;
+  // Only the default instance runs on the default queue
+  default_config = *config;
+  if(default_config.msgqueue == NULL)
+    default_config.msgqueue = ndn_msgqueue_get_default();
+  return ndn_fwd_init(&forwarder, &default_config);
+}
+
+void
+ndn_forwarder_process(void){
+  ndn_fwd_process(&forwarder);
+}
+
+int
+ndn_forwarder_register_face(ndn_face_intf_t* face)
+{
+  return ndn_fwd_register_face(&forwarder, face);
+}
+
+int
+ndn_forwarder_unregister_face(ndn_face_intf_t* face)
+{
+  return ndn_fwd_unregister_face(&forwarder, face);
+}
+
+int
+ndn_forwarder_add_route(ndn_face_intf_t* face, uint8_t* prefix, size_t length){
+  return ndn_fwd_add_route(&forwarder, face, prefix, length);
+}
+
+int
+ndn_forwarder_remove_route(ndn_face_intf_t* face, uint8_t* prefix, size_t length)
+{
+  return ndn_fwd_remove_route(&forwarder, face, prefix, length);
+}
+
+int
+ndn_forwarder_remove_all_routes(uint8_t* prefix, size_t length)
+{
+  return ndn_fwd_remove_all_routes(&forwarder, prefix, length);
 }
 
+int
+ndn_forwarder_receive_batch(ndn_face_intf_t* face,
+                            uint8_t* packets[],
+                            size_t lengths[],
+                            size_t count)
+{
+  return ndn_fwd_receive_batch(&forwarder, face, packets, lengths, count);
+}
+
+int
+ndn_forwarder_apply_route_batch(const ndn_route_update_t* updates, size_t count)
+{
+  return ndn_fwd_apply_route_batch(&forwarder, updates, count);
+}
+
+int
+ndn_forwarder_post_route_batch(ndn_route_batch_t* batch)
+{
+  return ndn_fwd_post_route_batch(&forwarder, batch);
+}
+
+int
+ndn_forwarder_enqueue(ndn_face_intf_t* face, const uint8_t* packet, size_t length)
+{
+  return ndn_fwd_enqueue(&forwarder, face, packet, length);
+}
+
+int
+ndn_forwarder_set_strategy(uint8_t* prefix, size_t length, const ndn_strategy_t* strategy)
+{
+  return ndn_fwd_set_strategy(&forwarder, prefix, length, strategy);
+}
+
+const ndn_measurements_entry_t*
+ndn_forwarder_get_measurements(uint8_t* prefix, size_t length, ndn_face_intf_t* face)
+{
+  return ndn_fwd_get_measurements(&forwarder, prefix, length, face);
+}
+
+ndn_face_measure_t*
+ndn_forwarder_get_face_measure(ndn_face_intf_t* face)
+{
+  return ndn_fwd_get_face_measure(&forwarder, face);
+}
+
+int
+ndn_forwarder_register_prefix(uint8_t* prefix,
+                              size_t length,
+                              ndn_on_interest_func on_interest,
+                              void* userdata)
+{
+  return ndn_fwd_register_prefix(&forwarder, prefix, length, on_interest, userdata);
+}
+
+int
+ndn_forwarder_unregister_prefix(uint8_t* prefix, size_t length)
+{
+  return ndn_fwd_unregister_prefix(&forwarder, prefix, length);
+}
+
+int
+ndn_forwarder_express_interest(uint8_t* interest,
+                               size_t length,
+                               ndn_on_data_func on_data,
+                               ndn_on_timeout_func on_timeout,
+                               void* userdata)
+{
+  return ndn_fwd_express_interest(&forwarder, interest, length, on_data, on_timeout, userdata);
+}
+
+int
+ndn_forwarder_express_interest_with_nack(uint8_t* interest,
+                                         size_t length,
+                                         ndn_on_data_func on_data,
+                                         ndn_on_timeout_func on_timeout,
+                                         ndn_on_nack_func on_nack,
+                                         void* userdata)
+{
+  return ndn_fwd_express_interest_with_nack(&forwarder, interest, length, on_data, on_timeout,
+                                            on_nack, userdata);
+}
+
+int
+ndn_forwarder_put_data(uint8_t* data, size_t length)
+{
+  return ndn_fwd_put_data(&forwarder, data, length);
+}
+
+int
+ndn_forwarder_receive(ndn_face_intf_t* face, uint8_t* packet, size_t length)
+{
+  return ndn_fwd_receive(&forwarder, face, packet, length);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
 static int
-fwd_on_incoming_interest(uint8_t* interest,
+fwd_on_incoming_interest(ndn_forwarder_t* self,
+                         uint8_t* interest,
                          size_t length,
                          interest_options_t* options,
-                         uint8_t* name,
-                         size_t name_len,
+                         const ndn_parsed_name_t* name,
                          ndn_table_id_t face_id)
 {
   ndn_pit_entry_t *pit_entry;
+  ndn_cs_entry_t *cs_entry;
+  int ret;
 
-  pit_entry = ndn_pit_find_or_insert(forwarder.pit, name, name_len);
+  // A Nonce seen before means the Interest looped back or is a duplicate
+  if(self->dead_nonce != NULL && options->nonce != 0 &&
+     ndn_dead_nonce_test_and_add(self->dead_nonce, name->hashes[name->count], options->nonce,
+                                 ndn_time_now_ms())){
+    fwd_send_nack(self, face_id, NDN_NACK_REASON_DUPLICATE, interest, length);
+    return NDN_FWD_INTEREST_REJECTED;
+  }
+
+  cs_entry = ndn_cs_match(self->cs, name, options);
+  if (cs_entry != NULL){
+    if(face_id != NDN_INVALID_ID && self->facetab->slots[face_id] != NULL){
+      ndn_face_send(self->facetab->slots[face_id], cs_entry->data, cs_entry->length);
+    }
+    return NDN_SUCCESS;
+  }
+
+  pit_entry = ndn_pit_find_or_insert(self->pit, name);
   if (pit_entry == NULL){
     return NDN_FWD_PIT_FULL;
   }
 
-  // Randomized dead nonce list
-  if(pit_entry->options.nonce == options->nonce && options->nonce != 0){
+  // Without a Dead Nonce List, only the last Nonce is remembered
+  if(self->dead_nonce == NULL && pit_entry->options.nonce == options->nonce && options->nonce != 0){
     return NDN_FWD_INTEREST_REJECTED;
   }
   if(pit_entry->on_data == NULL && pit_entry->on_timeout == NULL){
@@ -340,82 +933,154 @@ fwd_on_incoming_interest(uint8_t* interest,
     pit_entry->options = *options;
   }
   pit_entry->last_time = ndn_time_now_ms();
+  ndn_pit_update_timer(self->pit, pit_entry);
   if(face_id != NDN_INVALID_ID){
-    pit_entry->incoming_faces = bitset_set(pit_entry->incoming_faces, face_id);
+    faceset_set(&pit_entry->incoming_faces, face_id);
   }
 
-  return fwd_on_outgoing_interest(interest, length, name, name_len, pit_entry, face_id);
+  ret = fwd_on_outgoing_interest(self, interest, length, name, pit_entry, face_id);
+  if(ret == NDN_FWD_NO_ROUTE || ret == NDN_FWD_INTEREST_REJECTED){
+    if(pit_entry->send_time == 0){
+      // Nowhere to send it, so no downstream needs to wait
+      fwd_reject_interest(self, pit_entry, NDN_NACK_REASON_NO_ROUTE, interest, length);
+    }else{
+      // Former Interests are still pending upstream
+      fwd_send_nack(self, face_id, NDN_NACK_REASON_NO_ROUTE, interest, length);
+    }
+  }
+  return ret;
 }
 
 static int
-fwd_data_pipeline(uint8_t* data,
+fwd_data_pipeline(ndn_forwarder_t* self,
+                  uint8_t* data,
                   size_t length,
-                  uint8_t* name,
-                  size_t name_len,
+                  const ndn_parsed_name_t* name,
                   ndn_table_id_t face_id)
 {
-  ndn_pit_entry_t* pit_entry;
-
-  pit_entry = ndn_pit_prefix_match(forwarder.pit, name, name_len);
-  if (pit_entry == NULL) {
+  ndn_pit_entry_t *matched, *pit_entry;
+  ndn_table_id_t next;
+  ndn_faceset_t out_faces;
+  ndn_time_ms_t now;
+  // At most one entry per prefix of the name
+  ndn_table_id_t pit_ids[NDN_FORWARDER_MAX_COMPONENTS + 1];
+  ndn_table_id_t nametree_ids[NDN_FORWARDER_MAX_COMPONENTS + 1];
+  size_t cnt, i;
+  ndn_on_data_func on_data;
+  void* userdata;
+
+  matched = ndn_pit_match_data(self->pit, name);
+  if (matched == NULL) {
     return NDN_FWD_NO_ROUTE;
   }
-  if (!pit_entry->options.can_be_prefix) {
-    // Quick and dirty solution
-    if (ndn_pit_find(forwarder.pit, name, name_len) != pit_entry)
-      return NDN_FWD_NO_ROUTE;
-  }
 
-  if (pit_entry->on_data != NULL) {
-    pit_entry->on_data(data, length, pit_entry->userdata);
+  // Only solicited Data are cached
+  ndn_cs_insert(self->cs, name, data, length);
+
+  now = ndn_time_now_ms();
+  faceset_clear(&out_faces);
+  cnt = 0;
+  pit_entry = matched;
+  while (pit_entry != NULL) {
+    pit_ids[cnt] = (ndn_table_id_t)(pit_entry - self->pit->slots);
+    nametree_ids[cnt] = pit_entry->nametree_id;
+    cnt ++;
+    if (self->measurements != NULL && face_id != NDN_INVALID_ID && pit_entry->send_time != 0 &&
+        faceset_test(&pit_entry->outgoing_faces, face_id)) {
+      ndn_measurements_on_data(self->measurements, pit_entry->route_id, face_id,
+                               (uint32_t)(now - pit_entry->send_time));
+    }
+    if (pit_entry->strategy != NULL && pit_entry->strategy->on_data != NULL) {
+      pit_entry->strategy->on_data(self->facetab->measures, self->measurements, pit_entry, face_id, now);
+    }
+    faceset_union(&out_faces, &pit_entry->incoming_faces);
+    next = pit_entry->match_next;
+    pit_entry = (next != NDN_INVALID_ID) ? &self->pit->slots[next] : NULL;
   }
 
-  fwd_multicast(data, length, pit_entry->incoming_faces, face_id);
+  // Every downstream face gets one copy, however many entries it is in
+  fwd_multicast(self, data, length, out_faces, face_id);
 
-  ndn_pit_remove_entry(forwarder.pit, pit_entry);
+  // A callback may reenter the forwarder and remove or reuse any matched slot,
+  // so the slots are taken from the local copy and checked against their names.
+  // Each entry is removed before its callback, which may express a new Interest.
+  for (i = 0; i < cnt; i ++) {
+    pit_entry = &self->pit->slots[pit_ids[i]];
+    if (pit_entry->nametree_id != nametree_ids[i]) {
+      continue;
+    }
+    on_data = pit_entry->on_data;
+    userdata = pit_entry->userdata;
+    ndn_pit_remove_entry(self->pit, pit_entry);
+    if (on_data != NULL) {
+      on_data(data, length, userdata);
+    }
+  }
 
   return NDN_SUCCESS;
 }
 
-static ndn_bitset_t
-fwd_multicast(uint8_t* packet,
+static ndn_faceset_t
+fwd_multicast(ndn_forwarder_t* self,
+              uint8_t* packet,
               size_t length,
-              ndn_bitset_t out_faces,
+              ndn_faceset_t out_faces,
               ndn_table_id_t in_face)
 {
   ndn_table_id_t id;
   ndn_face_intf_t* face;
-  ndn_bitset_t ret = 0;
+  ndn_faceset_t ret;
+  ndn_pktbuf_t* buf = NULL;
 
-  while(out_faces != 0){
-    id = bitset_pop_least(&out_faces);
-    face = forwarder.facetab->slots[id];
+  faceset_clear(&ret);
+
+  while(!faceset_empty(&out_faces)){
+    id = faceset_pop_least(&out_faces);
+    face = self->facetab->slots[id];
     if(id != in_face && face != NULL){
-      ndn_face_send(face, packet, length);
-      ret = bitset_set(ret, id);
+      // One copy shared by all faces which can hold a reference
+      if(face->send_buf != NULL && buf == NULL && self->pktbufs != NULL){
+        buf = ndn_pktbuf_new(self->pktbufs, packet, length);
+      }
+      if(face->send_buf != NULL && buf != NULL){
+        ndn_face_send_buf(face, buf);
+      }else{
+        ndn_face_send(face, packet, length);
+      }
+      faceset_set(&ret, id);
     }
   }
+  if(buf != NULL){
+    ndn_pktbuf_unref(buf);
+  }
   return ret;
 }
 
 static int
-fwd_on_outgoing_interest(uint8_t* interest,
+fwd_on_outgoing_interest(ndn_forwarder_t* self,
+                         uint8_t* interest,
                          size_t length,
-                         uint8_t* name,
-                         size_t name_len,
+                         const ndn_parsed_name_t* name,
                          ndn_pit_entry_t* entry,
                          ndn_table_id_t face_id)
 {
   ndn_fib_entry_t* fib_entry;
   int strategy;
   uint8_t *hop_limit;
-  ndn_bitset_t outfaces;
+  ndn_faceset_t exclude;
+  ndn_time_ms_t now;
 
-  fib_entry = ndn_fib_prefix_match(forwarder.fib, name, name_len);
+  fib_entry = ndn_fib_prefix_match(self->fib, name);
   if(fib_entry == NULL){
     return NDN_FWD_NO_ROUTE;
   }
 
+  // Retransmissions too close to the last transmission are aggregated into it
+  now = ndn_time_now_ms();
+  if(entry->send_time != 0 && now - entry->send_time < entry->retx_interval){
+    return NDN_SUCCESS;
+  }
+
   if(fib_entry->on_interest){
     strategy = fib_entry->on_interest(interest, length, fib_entry->userdata);
   }else{
@@ -438,10 +1103,202 @@ fwd_on_outgoing_interest(uint8_t* interest,
     }
   }
 
-  outfaces = (fib_entry->nexthop & (~entry->outgoing_faces));
-  if(strategy == NDN_FWD_STRATEGY_MULTICAST){
-    entry->outgoing_faces |= fwd_multicast(interest, length, outfaces, face_id);
+  if(strategy != NDN_FWD_STRATEGY_MULTICAST){
+    return NDN_SUCCESS;
+  }
+
+  faceset_clear(&exclude);
+  if(face_id != NDN_INVALID_ID){
+    faceset_set(&exclude, face_id);
+  }
+  // Past the interval, a retransmission may go again to the faces already tried
+  fwd_send_interest(self, interest, length, entry, fib_entry, &exclude, entry->send_time != 0);
+
+  return NDN_SUCCESS;
+}
+
+static ndn_faceset_t
+fwd_send_interest(ndn_forwarder_t* self,
+                  uint8_t* interest,
+                  size_t length,
+                  ndn_pit_entry_t* entry,
+                  ndn_fib_entry_t* fib_entry,
+                  const ndn_faceset_t* exclude,
+                  bool retx)
+{
+  const ndn_strategy_t* impl;
+  ndn_faceset_t outfaces, candidates, sent;
+  ndn_table_id_t id;
+  bool rerouted;
+
+  // Strategies choose among the faces able to take the Interest
+  outfaces = fib_entry->nexthop;
+  faceset_minus(&outfaces, exclude);
+  faceset_clear(&candidates);
+  while(!faceset_empty(&outfaces)){
+    id = faceset_pop_least(&outfaces);
+    if(self->facetab->slots[id] != NULL){
+      faceset_set(&candidates, id);
+    }
+  }
+  // Faces not tried yet come first; a retransmission falls back to the tried ones
+  outfaces = candidates;
+  faceset_minus(&candidates, &entry->outgoing_faces);
+  if(faceset_empty(&candidates) && retx){
+    candidates = outfaces;
+  }else{
+    retx = false;
+  }
+  if(faceset_empty(&candidates)){
+    return candidates;
+  }
+
+  // The strategy reads the Measurements of the route the Interest goes under
+  rerouted = (self->measurements != NULL && entry->route_id != fib_entry->nametree_id);
+  if(rerouted){
+    // The route changed since the last transmission, so the former one is done.
+    // The entry references its route, which may outlive the FIB entry.
+    ndn_nametree_ref(self->nametree, ndn_nametree_at(self->nametree, fib_entry->nametree_id));
+    if(entry->route_id != NDN_INVALID_ID){
+      ndn_measurements_on_finish(self->measurements, entry->route_id, &entry->outgoing_faces);
+      ndn_nametree_unref(self->nametree, ndn_nametree_at(self->nametree, entry->route_id));
+    }
+    entry->route_id = fib_entry->nametree_id;
+  }
+
+  impl = (fib_entry->strategy != NULL ? fib_entry->strategy : &ndn_strategy_multicast);
+  outfaces = impl->on_interest(self->facetab->measures, self->measurements, entry, &candidates);
+  if(!retx){
+    faceset_minus(&outfaces, &entry->outgoing_faces);
+  }
+  sent = fwd_multicast(self, interest, length, outfaces, NDN_INVALID_ID);
+  if(!faceset_empty(&sent)){
+    // Faces sent again are already in flight under the same route
+    outfaces = sent;
+    if(!rerouted){
+      faceset_minus(&outfaces, &entry->outgoing_faces);
+    }
+    faceset_union(&entry->outgoing_faces, &sent);
+    faceset_minus(&entry->nacked_faces, &sent);
+    if(entry->send_time == 0){
+      entry->retx_interval = NDN_RETX_SUPPRESSION_INITIAL;
+    }else if(entry->retx_interval < NDN_RETX_SUPPRESSION_MAX / 2){
+      entry->retx_interval *= 2;
+    }else{
+      entry->retx_interval = NDN_RETX_SUPPRESSION_MAX;
+    }
+    entry->send_time = ndn_time_now_ms();
+    entry->strategy = impl;
+    while(self->measurements != NULL && !faceset_empty(&outfaces)){
+      ndn_measurements_on_send(self->measurements, entry->route_id, faceset_pop_least(&outfaces));
+    }
+  }
+  return sent;
+}
+
+static void
+fwd_send_nack(ndn_forwarder_t* self,
+              ndn_table_id_t face_id,
+              uint32_t reason,
+              uint8_t* interest,
+              size_t length)
+{
+  uint8_t buf[NDN_FORWARDER_NACK_SIZE];
+  size_t nack_len;
+  ndn_face_intf_t* face;
+
+  if(face_id == NDN_INVALID_ID || (face = self->facetab->slots[face_id]) == NULL){
+    return;
+  }
+  nack_len = tlv_make_nack(buf, sizeof(buf), reason, interest, length);
+  if(nack_len > 0){
+    ndn_face_send(face, buf, nack_len);
   }
+}
 
+static void
+fwd_reject_interest(ndn_forwarder_t* self,
+                    ndn_pit_entry_t* entry,
+                    uint32_t reason,
+                    uint8_t* interest,
+                    size_t length)
+{
+  ndn_faceset_t faces = entry->incoming_faces;
+  ndn_on_nack_func on_nack = entry->on_nack;
+  ndn_on_timeout_func on_timeout = entry->on_timeout;
+  bool expressed = (entry->on_data != NULL);
+  void* userdata = entry->userdata;
+
+  while(!faceset_empty(&faces)){
+    fwd_send_nack(self, faceset_pop_least(&faces), reason, interest, length);
+  }
+  ndn_pit_remove_entry(self->pit, entry);
+  // An application not handling Nacks learns it the way it would have after the lifetime
+  if(expressed && on_nack != NULL){
+    on_nack(interest, length, reason, userdata);
+  }else if(expressed && on_timeout != NULL){
+    on_timeout(userdata);
+  }
+}
+
+/** Whether Nack reason @c a is less severe than @c b.
+ * An unspecified reason is the most severe.
+ */
+static inline bool
+fwd_nack_less_severe(uint32_t a, uint32_t b)
+{
+  if(a == NDN_NACK_REASON_NONE)
+    return false;
+  if(b == NDN_NACK_REASON_NONE)
+    return true;
+  return a < b;
+}
+
+static int
+fwd_nack_pipeline(ndn_forwarder_t* self,
+                  uint8_t* interest,
+                  size_t length,
+                  const ndn_parsed_name_t* name,
+                  uint32_t reason,
+                  ndn_table_id_t face_id)
+{
+  ndn_pit_entry_t* entry;
+  ndn_fib_entry_t* fib_entry;
+  ndn_faceset_t pending;
+  bool retry = false;
+
+  entry = ndn_pit_find(self->pit, name);
+  if(entry == NULL || face_id == NDN_INVALID_ID ||
+     !faceset_test(&entry->outgoing_faces, face_id) || faceset_test(&entry->nacked_faces, face_id)){
+    return NDN_FWD_NO_EFFECT;
+  }
+
+  if(faceset_empty(&entry->nacked_faces) || fwd_nack_less_severe(reason, entry->nack_reason)){
+    entry->nack_reason = reason;
+  }
+  faceset_set(&entry->nacked_faces, face_id);
+  if(self->measurements != NULL){
+    faceset_clear(&pending);
+    faceset_set(&pending, face_id);
+    ndn_measurements_on_timeout(self->measurements, entry->route_id, &pending);
+  }
+  if(entry->strategy != NULL && entry->strategy->on_nack != NULL){
+    retry = entry->strategy->on_nack(self->facetab->measures, self->measurements, entry, face_id, reason,
+                                     ndn_time_now_ms());
+  }
+
+  // Fast failover, without waiting for the Interest to time out
+  if(retry){
+    fib_entry = ndn_fib_prefix_match(self->fib, name);
+    if(fib_entry != NULL){
+      fwd_send_interest(self, interest, length, entry, fib_entry, &entry->incoming_faces, false);
+    }
+  }
+
+  pending = entry->outgoing_faces;
+  faceset_minus(&pending, &entry->nacked_faces);
+  if(faceset_empty(&pending)){
+    fwd_reject_interest(self, entry, entry->nack_reason, interest, length);
+  }
   return NDN_SUCCESS;
 }
@@ -11,7 +11,12 @@
 
 #include "face.h"
 #include "callback-funcs.h"
+#include "strategy.h"
+#include "measurements.h"
+#include "parsed-name.h"
 #include "../util/msg-queue.h"
+#include "../util/bit-operations.h"
+#include "../util/atomic.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -27,11 +32,225 @@ extern "C" {
  * @{
  */
 
+/** Capacities and memory of the forwarder tables.
+ */
+typedef struct ndn_forwarder_config {
+  ndn_table_id_t nametree_size; ///< Maximum number of NameTree nodes. At least 2.
+  ndn_table_id_t facetab_size; ///< Maximum number of faces. At most #NDN_FACESET_CAPACITY.
+  ndn_table_id_t fib_size; ///< Maximum number of FIB entries.
+  ndn_table_id_t pit_size; ///< Maximum number of PIT entries.
+  ndn_table_id_t cs_size; ///< Maximum number of CS entries.
+
+  /**
+   * [Optional] Memory for the tables, in size of #ndn_forwarder_memory_size.
+   * It should be aligned to a pointer and stay valid while the forwarder is in use.
+   */
+  void* memory;
+
+  /**
+   * [Optional] Allocator of the tables' memory, used if @c memory is @c NULL.
+   * The allocated memory is never freed.
+   */
+  void* (*alloc)(size_t size);
+
+  /**
+   * The message queue of the forwarder, initialized by ndn_fwd_init() and owned by the instance.
+   * Instances never share a queue, since initializing one drops all queued messages.
+   * Only for ndn_forwarder_init_with_config(), @c NULL means the default queue of
+   * ndn_msgqueue_post().
+   */
+  ndn_msgqueue_t* msgqueue;
+
+  /**
+   * [Optional] Number of slots of the ingress ring, a power of 2.
+   * 0 for no ring; faces then call ndn_fwd_receive() on the forwarder's thread.
+   */
+  uint32_t ingress_size;
+
+  /**
+   * Maximum size of a packet in the ingress ring.
+   */
+  uint32_t ingress_packet_size;
+
+  /**
+   * [Optional] Number of packet buffers shared by faces implementing ndn_face_intf#send_buf.
+   * 0 for none; all faces then get their own copy.
+   */
+  uint32_t pktbuf_count;
+
+  /**
+   * Maximum size of a packet in a packet buffer.
+   */
+  uint32_t pktbuf_size;
+
+  /**
+   * [Optional] Maximum number of Measurements entries, one per (FIB prefix, face) pair.
+   * 0 for none.
+   */
+  ndn_table_id_t measurements_size;
+
+  /**
+   * [Optional] Number of (Name, Nonce) pairs kept to detect looping Interests,
+   * a power of 2 and at least #NDN_DEAD_NONCE_BUCKET_SLOTS.
+   * 0 to only compare with the last Nonce of the PIT entry.
+   */
+  uint32_t dead_nonce_size;
+} ndn_forwarder_config_t;
+
+/** Operations of a route update.
+ */
+enum {
+  NDN_ROUTE_ADD = 0,        ///< ndn_forwarder_add_route()
+  NDN_ROUTE_REMOVE = 1,     ///< ndn_forwarder_remove_route()
+  NDN_ROUTE_REMOVE_ALL = 2, ///< ndn_forwarder_remove_all_routes()
+};
+
+/** A change of the FIB.
+ */
+typedef struct ndn_route_update {
+  uint8_t op; ///< #NDN_ROUTE_ADD, #NDN_ROUTE_REMOVE or #NDN_ROUTE_REMOVE_ALL.
+  ndn_face_intf_t* face; ///< The face of the route. Ignored by #NDN_ROUTE_REMOVE_ALL.
+  uint8_t* prefix; ///< The prefix of the route.
+  size_t length; ///< The length of @c prefix.
+} ndn_route_update_t;
+
+/**
+ * Route updates handed from a control thread to forwarder threads.
+ *
+ * The forwarders apply the whole batch between two packets,
+ * so the packet path sees the FIB either before or after all the updates.
+ * The batch and its updates are owned by the forwarders until ndn_route_batch_done().
+ */
+typedef struct ndn_route_batch {
+  const ndn_route_update_t* updates;
+  size_t count;
+
+  /** Number of forwarders yet to apply the batch.
+   */
+  NDN_ATOMIC(unsigned int) pending;
+
+  /** Number of updates failed, summed over the forwarders.
+   */
+  NDN_ATOMIC(size_t) failures;
+} ndn_route_batch_t;
+
+struct ndn_nametree;
+struct ndn_face_table;
+struct ndn_fib;
+struct ndn_pit;
+struct ndn_cs;
+struct ndn_measurements;
+struct ndn_dead_nonce;
+struct ndn_ingress_ring;
+struct ndn_pktbuf_pool;
+
+/**
+ * NDN-Lite forwarder.
+ *
+ * An application normally uses the default instance through the ndn_forwarder_* functions.
+ * Other instances are driven by the ndn_fwd_* functions and share no mutable state,
+ * so each of them can run on its own core.
+ * Initialize an instance with ndn_fwd_init() before use.
+ */
+typedef struct ndn_forwarder {
+  struct ndn_nametree* nametree;
+  struct ndn_face_table* facetab;
+
+  /**
+   * The forwarding information base (FIB).
+   */
+  struct ndn_fib* fib;
+  /**
+   * The pending Interest table (PIT).
+   */
+  struct ndn_pit* pit;
+  /**
+   * The content store (CS).
+   */
+  struct ndn_cs* cs;
+
+  /**
+   * The memory holding all tables.
+   */
+  uint8_t* memory;
+
+  /**
+   * The message queue processed by ndn_fwd_process().
+   */
+  ndn_msgqueue_t* msgqueue;
+
+  /**
+   * Packets pushed by face threads, drained by ndn_fwd_process().
+   * @c NULL if not configured.
+   */
+  struct ndn_ingress_ring* ingress;
+
+  /**
+   * Packet buffers multicast to faces without copying.
+   * @c NULL if not configured.
+   */
+  struct ndn_pktbuf_pool* pktbufs;
+
+  /**
+   * Statistics of Interests by FIB prefix and face.
+   * @c NULL if not configured.
+   */
+  struct ndn_measurements* measurements;
+
+  /**
+   * Recently seen Nonces, kept after PIT entries leave.
+   * @c NULL if not configured.
+   */
+  struct ndn_dead_nonce* dead_nonce;
+
+  /**
+   * Route batch posted by the control thread, applied by ndn_fwd_process().
+   * @c NULL if none.
+   */
+  NDN_ATOMIC(ndn_route_batch_t*) route_batch;
+} ndn_forwarder_t;
+
 /** Initialize all components of the forwarder.
+ *
+ * Tables are sized by #NDN_NAMETREE_MAX_SIZE, #NDN_FACE_TABLE_MAX_SIZE, #NDN_FIB_MAX_SIZE,
+ * #NDN_PIT_MAX_SIZE, #NDN_CS_MAX_SIZE and #NDN_DEAD_NONCE_LIST_SIZE, and kept in static memory.
  */
 void
 ndn_forwarder_init(void);
 
+/** Get the memory size needed by the tables.
+ *
+ * @param[in] config The capacities of the tables.
+ * @return The size in bytes.
+ */
+size_t
+ndn_forwarder_memory_size(const ndn_forwarder_config_t* config);
+
+/** Check the capacities of the tables, without allocating any memory.
+ *
+ * @param[in] config The capacities, memory and message queue of the tables.
+ * @return #NDN_SUCCESS if ndn_fwd_init() accepts @c config. The error code it returns otherwise.
+ */
+int
+ndn_forwarder_check_config(const ndn_forwarder_config_t* config);
+
+/** Initialize all components of the forwarder with table sizes decided at runtime.
+ *
+ * @param[in] config The capacities and memory of the tables.
+ * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
+ * @retval #NDN_INVALID_POINTER Neither @c memory nor @c alloc is given.
+ * @retval #NDN_OVERSIZE A capacity is out of range.
+ *                       Define @c NDN_FORWARDER_LARGE_TABLES for tables larger than 65534.
+ * @retval #NDN_FWD_NO_MEMORY @c alloc failed.
+ */
+int
+ndn_forwarder_init_with_config(const ndn_forwarder_config_t* config);
+
+/** Get the default forwarder instance used by the ndn_forwarder_* functions.
+ */
+ndn_forwarder_t*
+ndn_forwarder_get_default(void);
+
 /** Process event messages.
  *
  * This should be called at a fixed interval.
@@ -101,12 +320,99 @@ ndn_forwarder_remove_route(ndn_face_intf_t* face, uint8_t* prefix, size_t length
 int
 ndn_forwarder_remove_all_routes(uint8_t* prefix, size_t length);
 
+/** Apply a batch of route updates to FIB.
+ *
+ * Must be called on the forwarder's thread.
+ * Failed updates are skipped; later ones are still applied.
+ * @param[in] updates The updates, applied in order.
+ * @param[in] count The number of @c updates.
+ * @return The number of updates applied successfully.
+ *         #NDN_INVALID_POINTER if @c updates is @c NULL.
+ */
+int
+ndn_forwarder_apply_route_batch(const ndn_route_update_t* updates, size_t count);
+
+/** Post a batch of route updates to be applied by ndn_forwarder_process().
+ * @sa ndn_fwd_post_route_batch
+ */
+int
+ndn_forwarder_post_route_batch(ndn_route_batch_t* batch);
+
+/** Tell whether all forwarders a batch was posted to have applied it.
+ *
+ * The control thread may reuse or free the batch and its updates afterwards.
+ * @param[in] batch The batch.
+ * @return Whether the batch is done.
+ */
+bool
+ndn_route_batch_done(ndn_route_batch_t* batch);
+
 /** Receive a packet from a face.
  *
+ * Must be called on the forwarder's thread. Face threads use ndn_forwarder_enqueue().
+ * The name is parsed once, and all table lookups of the packet share the result.
+ * @retval #NDN_OVERSIZE The name has more than #NDN_FORWARDER_MAX_COMPONENTS components.
  */
 int
 ndn_forwarder_receive(ndn_face_intf_t* face, uint8_t* packet, size_t length);
 
+/** Receive a batch of packets from a face.
+ *
+ * Headers of up to #NDN_FORWARDER_BATCH_SIZE packets are parsed and their NameTree nodes
+ * are prefetched together. Then the packets go through the forwarding pipelines one by one,
+ * in the order they are given.
+ * @param[in] face The face receiving the packets.
+ * @param[in] packets The packets.
+ * @param[in] lengths The lengths of @c packets.
+ * @param[in] count The number of packets.
+ * @return The number of packets processed successfully. Malformed packets are skipped.
+ *         #NDN_INVALID_POINTER if @c packets or @c lengths is @c NULL.
+ */
+int
+ndn_forwarder_receive_batch(ndn_face_intf_t* face,
+                            uint8_t* packets[],
+                            size_t lengths[],
+                            size_t count);
+
+/** Queue a packet received by a face into the ingress ring of the default instance.
+ * @sa ndn_fwd_enqueue
+ */
+int
+ndn_forwarder_enqueue(ndn_face_intf_t* face, const uint8_t* packet, size_t length);
+
+/** Set the forwarding strategy of a prefix.
+ *
+ * Interests matching the FIB entry of @c prefix go to the next hops chosen by @c strategy.
+ * The setting is dropped with the FIB entry when its last route and registration are removed.
+ * @param[in] prefix The prefix, which must have a route or registration.
+ * @param[in] length The length of @c prefix.
+ * @param[in] strategy The strategy, such as #ndn_strategy_best_route.
+ *                     @c NULL for the default, #ndn_strategy_multicast.
+ * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
+ * @retval #NDN_FWD_NO_ROUTE @c prefix has no FIB entry.
+ */
+int
+ndn_forwarder_set_strategy(uint8_t* prefix, size_t length, const ndn_strategy_t* strategy);
+
+/** Get the measurements of a face, to read RTT or set cost and weight.
+ *
+ * @param[in] face A registered face.
+ * @return The measurements. @c NULL if @c face is not registered.
+ */
+ndn_face_measure_t*
+ndn_forwarder_get_face_measure(ndn_face_intf_t* face);
+
+/** Get the measurements of Interests forwarded under a FIB prefix through a face.
+ *
+ * Needs ndn_forwarder_config#measurements_size.
+ * @param[in] prefix The prefix of a FIB entry.
+ * @param[in] length The length of @c prefix.
+ * @param[in] face The face.
+ * @return The entry. @c NULL if nothing is measured.
+ */
+const ndn_measurements_entry_t*
+ndn_forwarder_get_measurements(uint8_t* prefix, size_t length, ndn_face_intf_t* face);
+
 /** Register a prefix.
  *
  * A latter registration cancels the former one.
@@ -138,6 +444,7 @@ ndn_forwarder_unregister_prefix(uint8_t* prefix, size_t length);
  *
  * A repeated expression cancels the former expression with the same name.
  * Either @c on_data or @c on_timeout will be called only once.
+ * If the content store has a matching Data, @c on_data is called before this function returns.
  * @param[in] interest The interest to express.
  * @param[in] length The length of @c interest.
  * @param[in] on_data The callback function when a data comes.
@@ -154,6 +461,22 @@ ndn_forwarder_express_interest(uint8_t* interest,
                                ndn_on_timeout_func on_timeout,
                                void* userdata);
 
+/** Express an interest, and learn when the network rejects it.
+ *
+ * Same as ndn_forwarder_express_interest(), except that @c on_nack is called instead of
+ * @c on_timeout when all next hops return a Nack or there is no route.
+ * Without @c on_nack, @c on_timeout is called at that time.
+ * @param[in] on_nack [Optional] The callback function when a Nack comes.
+ * @sa ndn_forwarder_express_interest
+ */
+int
+ndn_forwarder_express_interest_with_nack(uint8_t* interest,
+                                         size_t length,
+                                         ndn_on_data_func on_data,
+                                         ndn_on_timeout_func on_timeout,
+                                         ndn_on_nack_func on_nack,
+                                         void* userdata);
+
 /** Produce a data packet.
  *
  * @param[in] data The data to produce.
@@ -163,6 +486,215 @@ ndn_forwarder_express_interest(uint8_t* interest,
 int
 ndn_forwarder_put_data(uint8_t* data, size_t length);
 
+/** Initialize a forwarder instance.
+ *
+ * @param[out] self The instance to initialize.
+ * @param[in] config The capacities, memory and message queue of the instance.
+ * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
+ * @retval #NDN_INVALID_POINTER @c msgqueue is not given, or neither @c memory nor @c alloc is.
+ * @sa ndn_forwarder_init_with_config
+ */
+int
+ndn_fwd_init(ndn_forwarder_t* self, const ndn_forwarder_config_t* config);
+
+/** Process received packets and event messages of a forwarder instance.
+ *
+ * Packets in the ingress ring are processed first,
+ * at most as many as the ring holds when the call starts.
+ * @sa ndn_forwarder_process
+ */
+void
+ndn_fwd_process(ndn_forwarder_t* self);
+
+/** Queue a packet received by a face into the ingress ring of a forwarder instance.
+ *
+ * Safe to call from any thread. The header is parsed on the calling thread,
+ * then the packet is copied and processed by ndn_fwd_process().
+ * @param[in, out] self The forwarder instance, with an ingress ring.
+ * @param[in] face The face receiving @c packet.
+ * @param[in] packet The packet.
+ * @param[in] length The length of @c packet.
+ * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
+ *         A malformed packet is not queued, and its parse error is returned.
+ * @retval #NDN_INVALID_POINTER The instance has no ingress ring.
+ * @retval #NDN_FWD_INGRESS_FULL The ring is full. The packet is dropped.
+ * @retval #NDN_OVERSIZE @c packet is larger than ndn_forwarder_config#ingress_packet_size.
+ */
+int
+ndn_fwd_enqueue(ndn_forwarder_t* self, ndn_face_intf_t* face, const uint8_t* packet, size_t length);
+
+/** Get the number of packets dropped by the ingress ring of a forwarder instance.
+ */
+size_t
+ndn_fwd_ingress_drops(ndn_forwarder_t* self);
+
+/** Register a new face to a forwarder instance.
+ *
+ * A face belongs to at most one instance at a time.
+ * @sa ndn_forwarder_register_face
+ */
+int
+ndn_fwd_register_face(ndn_forwarder_t* self, ndn_face_intf_t* face);
+
+/** Unregister a face from a forwarder instance.
+ *
+ * Takes constant time, without scanning the tables. The FaceTable counts
+ * unregistrations, and FIB, PIT and Measurements entries are stamped with the count.
+ * An entry drops the faces unregistered after its stamp when it is next looked up,
+ * so the face's ID can be given to a new face at once.
+ * @sa ndn_forwarder_unregister_face
+ */
+int
+ndn_fwd_unregister_face(ndn_forwarder_t* self, ndn_face_intf_t* face);
+
+/** Add a route into the FIB of a forwarder instance.
+ * @sa ndn_forwarder_add_route
+ */
+int
+ndn_fwd_add_route(ndn_forwarder_t* self, ndn_face_intf_t* face, uint8_t* prefix, size_t length);
+
+/** Remove a route from the FIB of a forwarder instance.
+ * @sa ndn_forwarder_remove_route
+ */
+int
+ndn_fwd_remove_route(ndn_forwarder_t* self, ndn_face_intf_t* face, uint8_t* prefix, size_t length);
+
+/** Remove all routes of a prefix from the FIB of a forwarder instance.
+ * @sa ndn_forwarder_remove_all_routes
+ */
+int
+ndn_fwd_remove_all_routes(ndn_forwarder_t* self, uint8_t* prefix, size_t length);
+
+/** Apply a batch of route updates to the FIB of a forwarder instance.
+ * @sa ndn_forwarder_apply_route_batch
+ */
+int
+ndn_fwd_apply_route_batch(ndn_forwarder_t* self, const ndn_route_update_t* updates, size_t count);
+
+/** Post a batch of route updates to a forwarder instance.
+ *
+ * Safe to call from one control thread while the forwarder's thread runs.
+ * The batch is applied by the next ndn_fwd_process(), before any packet of the ingress ring.
+ * @param[in, out] self The forwarder instance.
+ * @param[in, out] batch The batch. Its counters are reset.
+ * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
+ * @retval #NDN_FWD_ROUTE_BATCH_BUSY The previous batch has not been taken yet.
+ */
+int
+ndn_fwd_post_route_batch(ndn_forwarder_t* self, ndn_route_batch_t* batch);
+
+/** Receive a packet from a face registered to a forwarder instance.
+ * @sa ndn_forwarder_receive
+ */
+int
+ndn_fwd_receive(ndn_forwarder_t* self, ndn_face_intf_t* face, uint8_t* packet, size_t length);
+
+/** Receive a batch of packets from a face registered to a forwarder instance.
+ * @sa ndn_forwarder_receive_batch
+ */
+int
+ndn_fwd_receive_batch(ndn_forwarder_t* self,
+                      ndn_face_intf_t* face,
+                      uint8_t* packets[],
+                      size_t lengths[],
+                      size_t count);
+
+/** Receive a packet whose header the caller has parsed already.
+ *
+ * For callers which parse packets anyway, such as a forwarder pool choosing the shard.
+ * @param[in, out] self The forwarder instance.
+ * @param[in] face The face receiving the packet.
+ * @param[in] parsed The packet, parsed by ndn_parsed_packet_init().
+ * @sa ndn_fwd_receive
+ */
+int
+ndn_fwd_receive_parsed(ndn_forwarder_t* self, ndn_face_intf_t* face, ndn_parsed_packet_t* parsed);
+
+/** Set the forwarding strategy of a prefix in a forwarder instance.
+ * @sa ndn_forwarder_set_strategy
+ */
+int
+ndn_fwd_set_strategy(ndn_forwarder_t* self,
+                     uint8_t* prefix,
+                     size_t length,
+                     const ndn_strategy_t* strategy);
+
+/** Get the measurements of a face registered to a forwarder instance.
+ * @sa ndn_forwarder_get_face_measure
+ */
+ndn_face_measure_t*
+ndn_fwd_get_face_measure(ndn_forwarder_t* self, ndn_face_intf_t* face);
+
+/** Get the measurements of a prefix and a face in a forwarder instance.
+ * @sa ndn_forwarder_get_measurements
+ */
+const ndn_measurements_entry_t*
+ndn_fwd_get_measurements(ndn_forwarder_t* self, uint8_t* prefix, size_t length, ndn_face_intf_t* face);
+
+/** Register a prefix to a forwarder instance.
+ * @sa ndn_forwarder_register_prefix
+ */
+int
+ndn_fwd_register_prefix(ndn_forwarder_t* self,
+                        uint8_t* prefix,
+                        size_t length,
+                        ndn_on_interest_func on_interest,
+                        void* userdata);
+
+/** Unregister a prefix from a forwarder instance.
+ * @sa ndn_forwarder_unregister_prefix
+ */
+int
+ndn_fwd_unregister_prefix(ndn_forwarder_t* self, uint8_t* prefix, size_t length);
+
+/** Express an interest through a forwarder instance.
+ * @sa ndn_forwarder_express_interest
+ */
+int
+ndn_fwd_express_interest(ndn_forwarder_t* self,
+                         uint8_t* interest,
+                         size_t length,
+                         ndn_on_data_func on_data,
+                         ndn_on_timeout_func on_timeout,
+                         void* userdata);
+
+/** Express an interest with a Nack callback through a forwarder instance.
+ * @sa ndn_forwarder_express_interest_with_nack
+ */
+int
+ndn_fwd_express_interest_with_nack(ndn_forwarder_t* self,
+                                   uint8_t* interest,
+                                   size_t length,
+                                   ndn_on_data_func on_data,
+                                   ndn_on_timeout_func on_timeout,
+                                   ndn_on_nack_func on_nack,
+                                   void* userdata);
+
+/** Express an interest parsed by ndn_parsed_packet_init() through a forwarder instance.
+ * @retval #NDN_WRONG_TLV_TYPE @c interest is not an Interest.
+ * @sa ndn_fwd_express_interest_with_nack
+ */
+int
+ndn_fwd_express_interest_parsed(ndn_forwarder_t* self,
+                                ndn_parsed_packet_t* interest,
+                                ndn_on_data_func on_data,
+                                ndn_on_timeout_func on_timeout,
+                                ndn_on_nack_func on_nack,
+                                void* userdata);
+
+/** Produce a data packet through a forwarder instance.
+ * @sa ndn_forwarder_put_data
+ */
+int
+ndn_fwd_put_data(ndn_forwarder_t* self, uint8_t* data, size_t length);
+
+/** Produce a data packet parsed by ndn_parsed_packet_init() through a forwarder instance.
+ * @retval #NDN_WRONG_TLV_TYPE @c data is not a Data.
+ * @sa ndn_fwd_put_data
+ */
+int
+ndn_fwd_put_data_parsed(ndn_forwarder_t* self, ndn_parsed_packet_t* data);
+
 /*@}*/
 
 #ifdef __cplusplus
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "ingress-ring.h"
+#include <stdbool.h>
+#include <string.h>
+#include "../ndn-error-code.h"
+
+static inline ndn_ingress_slot_t*
+ndn_ingress_ring_at(ndn_ingress_ring_t* self, size_t pos)
+{
+  return (ndn_ingress_slot_t*)&self->slots[(pos & (self->capacity - 1)) * self->stride];
+}
+
+void
+ndn_ingress_ring_init(void* memory, size_t capacity, size_t packet_size)
+{
+  ndn_ingress_ring_t* self = (ndn_ingress_ring_t*)memory;
+  size_t i;
+
+  self->capacity = capacity;
+  self->packet_size = packet_size;
+  self->stride = NDN_INGRESS_SLOT_STRIDE(packet_size);
+  atomic_init(&self->drops, 0);
+  atomic_init(&self->tail, 0);
+  self->head = 0;
+  for(i = 0; i < capacity; i ++){
+    atomic_init(&ndn_ingress_ring_at(self, i)->seq, i);
+  }
+}
+
+int
+ndn_ingress_ring_push(ndn_ingress_ring_t* self,
+                      ndn_face_intf_t* face,
+                      const uint8_t* packet,
+                      size_t length,
+                      const ndn_parsed_packet_t* parsed)
+{
+  ndn_ingress_slot_t* slot;
+  size_t pos, seq;
+
+  if(length > self->packet_size){
+    atomic_fetch_add_explicit(&self->drops, 1, memory_order_relaxed);
+    return NDN_OVERSIZE;
+  }
+
+  // Claim a free slot
+  pos = atomic_load_explicit(&self->tail, memory_order_relaxed);
+  while(true){
+    slot = ndn_ingress_ring_at(self, pos);
+    seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if(seq == pos){
+      if(atomic_compare_exchange_weak_explicit(&self->tail, &pos, pos + 1,
+                                               memory_order_relaxed, memory_order_relaxed))
+        break;
+    }else if((ptrdiff_t)(seq - pos) < 0){
+      // The consumer has not released this slot yet
+      atomic_fetch_add_explicit(&self->drops, 1, memory_order_relaxed);
+      return NDN_FWD_INGRESS_FULL;
+    }else{
+      pos = atomic_load_explicit(&self->tail, memory_order_relaxed);
+    }
+  }
+
+  slot->face = face;
+  slot->length = length;
+  memcpy(slot->packet, packet, length);
+  slot->parsed = *parsed;
+  ndn_parsed_packet_rebase(&slot->parsed, packet, slot->packet);
+  atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+  return NDN_SUCCESS;
+}
+
+ndn_ingress_slot_t*
+ndn_ingress_ring_front(ndn_ingress_ring_t* self)
+{
+  ndn_ingress_slot_t* slot = ndn_ingress_ring_at(self, self->head);
+  if(atomic_load_explicit(&slot->seq, memory_order_acquire) != self->head + 1)
+    return NULL;
+  return slot;
+}
+
+void
+ndn_ingress_ring_pop(ndn_ingress_ring_t* self)
+{
+  ndn_ingress_slot_t* slot = ndn_ingress_ring_at(self, self->head);
+  atomic_store_explicit(&slot->seq, self->head + self->capacity, memory_order_release);
+  self->head ++;
+}
+
+size_t
+ndn_ingress_ring_drops(ndn_ingress_ring_t* self)
+{
+  return atomic_load_explicit(&self->drops, memory_order_relaxed);
+}
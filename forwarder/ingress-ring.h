@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef FORWARDER_INGRESS_RING_H_
+#define FORWARDER_INGRESS_RING_H_
+
+#include <stdalign.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "face.h"
+#include "parsed-name.h"
+#include "../util/atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup NDNFwdIngress Ingress Ring
+ * @brief Lock-free queue of received packets.
+ *
+ * A bounded multi-producer single-consumer ring.
+ * Face threads push packets without locking; the forwarder thread pops them.
+ * Packets are copied into the ring, so the face can reuse its buffer right after the push.
+ * Face threads parse the packets before the push, so the forwarder thread does not parse them again.
+ * @ingroup NDNFwd
+ * @{
+ */
+
+/**
+ * A slot of the ring holding one packet.
+ */
+typedef struct ndn_ingress_slot {
+  /** The sequence number.
+   * Equal to the position when free, position + 1 when holding a packet.
+   */
+  NDN_ATOMIC(size_t) seq;
+
+  /** The face receiving the packet.
+   */
+  ndn_face_intf_t* face;
+
+  /** The length of @c packet.
+   */
+  size_t length;
+
+  /** The header of @c packet, pointing into @c packet.
+   */
+  ndn_parsed_packet_t parsed;
+
+  uint8_t packet[];
+} ndn_ingress_slot_t;
+
+/**
+ * Ingress ring.
+ */
+typedef struct ndn_ingress_ring {
+  /** Number of slots, a power of 2.
+   */
+  size_t capacity;
+
+  /** Maximum size of a packet.
+   */
+  size_t packet_size;
+
+  /** Distance between two slots in bytes.
+   */
+  size_t stride;
+
+  /** Number of packets dropped because the ring is full or they are too large.
+   */
+  NDN_ATOMIC(size_t) drops;
+
+  /** The next position to push, shared by producers.
+   */
+  NDN_ATOMIC(size_t) tail;
+
+  /** The next position to pop, owned by the consumer.
+   */
+  size_t head;
+
+  alignas(ndn_ingress_slot_t) uint8_t slots[];
+} ndn_ingress_ring_t;
+
+#define NDN_INGRESS_SLOT_STRIDE(packet_size) \
+  ((sizeof(ndn_ingress_slot_t) + (packet_size) + alignof(ndn_ingress_slot_t) - 1) / \
+   alignof(ndn_ingress_slot_t) * alignof(ndn_ingress_slot_t))
+
+#define NDN_INGRESS_RING_RESERVE_SIZE(slot_count, packet_size) \
+  (sizeof(ndn_ingress_ring_t) + NDN_INGRESS_SLOT_STRIDE(packet_size) * (slot_count))
+
+/** Initialize a ring at specified memory space.
+ * @param[in, out] memory Memory in size of #NDN_INGRESS_RING_RESERVE_SIZE.
+ * @param[in] capacity Number of slots. Must be a power of 2.
+ * @param[in] packet_size Maximum size of a packet.
+ */
+void
+ndn_ingress_ring_init(void* memory, size_t capacity, size_t packet_size);
+
+/** Push a packet. Safe to call from any thread.
+ * @param[in, out] self The ring.
+ * @param[in] face The face receiving @c packet.
+ * @param[in] packet The packet, copied into the ring.
+ * @param[in] length The length of @c packet.
+ * @param[in] parsed The header of @c packet, pointing into @c packet.
+ * @retval #NDN_SUCCESS The packet is queued.
+ * @retval #NDN_FWD_INGRESS_FULL The ring is full. The packet is dropped and counted.
+ * @retval #NDN_OVERSIZE The packet is too large. The packet is dropped and counted.
+ */
+int
+ndn_ingress_ring_push(ndn_ingress_ring_t* self,
+                      ndn_face_intf_t* face,
+                      const uint8_t* packet,
+                      size_t length,
+                      const ndn_parsed_packet_t* parsed);
+
+/** Get the oldest packet. Only called by the consumer.
+ * @param[in] self The ring.
+ * @return The slot of the packet. @c NULL if the ring is empty.
+ */
+ndn_ingress_slot_t*
+ndn_ingress_ring_front(ndn_ingress_ring_t* self);
+
+/** Release the slot returned by ndn_ingress_ring_front(). Only called by the consumer.
+ * @param[in, out] self The ring.
+ */
+void
+ndn_ingress_ring_pop(ndn_ingress_ring_t* self);
+
+/** Get the number of dropped packets.
+ * @param[in] self The ring.
+ */
+size_t
+ndn_ingress_ring_drops(ndn_ingress_ring_t* self);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FORWARDER_INGRESS_RING_H_
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "measurements.h"
+
+static inline void
+ndn_measurements_entry_clear_stats(ndn_measurements_entry_t* self){
+  self->srtt = 0;
+  self->rttvar = 0;
+  self->satisfaction = 1000;
+  self->in_flight = 0;
+}
+
+static inline void
+ndn_measurements_entry_reset(ndn_measurements_entry_t* self){
+  self->nametree_id = NDN_INVALID_ID;
+  self->face_id = NDN_INVALID_ID;
+  self->sibling = NDN_INVALID_ID;
+  self->face_epoch = 0;
+  ndn_measurements_entry_clear_stats(self);
+  self->prev = NDN_INVALID_ID;
+}
+
+void
+ndn_measurements_init(void* memory, ndn_table_id_t capacity, ndn_nametree_t* nametree){
+  ndn_table_id_t i;
+  ndn_measurements_t* self = (ndn_measurements_t*)memory;
+  self->capacity = capacity;
+  self->nametree = nametree;
+  self->facetab = NULL;
+  self->lru_head = self->lru_tail = NDN_INVALID_ID;
+  // All free entries are linked by next
+  for(i = 0; i < capacity; i ++){
+    ndn_measurements_entry_reset(&self->slots[i]);
+    self->slots[i].next = i + 1;
+  }
+  if(capacity > 0){
+    self->slots[capacity - 1].next = NDN_INVALID_ID;
+    self->free_head = 0;
+  }else{
+    self->free_head = NDN_INVALID_ID;
+  }
+}
+
+static void
+ndn_measurements_lru_unlink(ndn_measurements_t* self, ndn_table_id_t id){
+  ndn_measurements_entry_t* entry = &self->slots[id];
+  if(entry->prev != NDN_INVALID_ID){
+    self->slots[entry->prev].next = entry->next;
+  }else{
+    self->lru_head = entry->next;
+  }
+  if(entry->next != NDN_INVALID_ID){
+    self->slots[entry->next].prev = entry->prev;
+  }else{
+    self->lru_tail = entry->prev;
+  }
+  entry->prev = entry->next = NDN_INVALID_ID;
+}
+
+static void
+ndn_measurements_lru_push_front(ndn_measurements_t* self, ndn_table_id_t id){
+  ndn_measurements_entry_t* entry = &self->slots[id];
+  entry->prev = NDN_INVALID_ID;
+  entry->next = self->lru_head;
+  if(self->lru_head != NDN_INVALID_ID){
+    self->slots[self->lru_head].prev = id;
+  }else{
+    self->lru_tail = id;
+  }
+  self->lru_head = id;
+}
+
+static void
+ndn_measurements_remove_entry(ndn_measurements_t* self, ndn_table_id_t id){
+  ndn_measurements_entry_t* entry = &self->slots[id];
+  nametree_entry_t* node;
+  ndn_table_id_t* link;
+
+  if(entry->nametree_id == NDN_INVALID_ID){
+    return;
+  }
+  node = ndn_nametree_at(self->nametree, entry->nametree_id);
+  for(link = &node->measurements_id; *link != id; link = &self->slots[*link].sibling);
+  *link = entry->sibling;
+  ndn_nametree_unref(self->nametree, node);
+  ndn_measurements_lru_unlink(self, id);
+  ndn_measurements_entry_reset(entry);
+  entry->next = self->free_head;
+  self->free_head = id;
+}
+
+// Find the entry of a face ID, which may belong to a face unregistered since
+static ndn_measurements_entry_t*
+ndn_measurements_lookup(ndn_measurements_t* self, ndn_table_id_t nametree_id, ndn_table_id_t face_id){
+  ndn_table_id_t id;
+
+  if(nametree_id == NDN_INVALID_ID){
+    return NULL;
+  }
+  id = ndn_nametree_at(self->nametree, nametree_id)->measurements_id;
+  for(; id != NDN_INVALID_ID; id = self->slots[id].sibling){
+    if(self->slots[id].face_id == face_id){
+      return &self->slots[id];
+    }
+  }
+  return NULL;
+}
+
+static inline bool
+ndn_measurements_entry_stale(ndn_measurements_t* self, ndn_measurements_entry_t* entry){
+  return self->facetab != NULL && ndn_facetab_stale(self->facetab, entry->face_id, entry->face_epoch);
+}
+
+ndn_measurements_entry_t*
+ndn_measurements_find(ndn_measurements_t* self, ndn_table_id_t nametree_id, ndn_table_id_t face_id){
+  ndn_measurements_entry_t* entry = ndn_measurements_lookup(self, nametree_id, face_id);
+
+  if(entry == NULL || ndn_measurements_entry_stale(self, entry)){
+    return NULL;
+  }
+  return entry;
+}
+
+void
+ndn_measurements_on_send(ndn_measurements_t* self, ndn_table_id_t nametree_id, ndn_table_id_t face_id){
+  ndn_measurements_entry_t* entry = ndn_measurements_lookup(self, nametree_id, face_id);
+  nametree_entry_t* node;
+  ndn_table_id_t id;
+
+  if(entry == NULL){
+    if(self->free_head == NDN_INVALID_ID){
+      if(self->lru_tail == NDN_INVALID_ID){
+        return;
+      }
+      ndn_measurements_remove_entry(self, self->lru_tail);
+    }
+    id = self->free_head;
+    self->free_head = self->slots[id].next;
+    entry = &self->slots[id];
+    ndn_measurements_entry_reset(entry);
+    node = ndn_nametree_at(self->nametree, nametree_id);
+    ndn_nametree_ref(self->nametree, node);
+    entry->nametree_id = nametree_id;
+    entry->face_id = face_id;
+    entry->face_epoch = (self->facetab != NULL ? self->facetab->epoch : 0);
+    entry->sibling = node->measurements_id;
+    node->measurements_id = id;
+    ndn_measurements_lru_push_front(self, id);
+  }else{
+    // The statistics of a face gone since do not apply to the face now holding the ID
+    if(ndn_measurements_entry_stale(self, entry)){
+      ndn_measurements_entry_clear_stats(entry);
+      entry->face_epoch = self->facetab->epoch;
+    }
+    id = entry - self->slots;
+    ndn_measurements_lru_unlink(self, id);
+    ndn_measurements_lru_push_front(self, id);
+  }
+  if(entry->in_flight < UINT16_MAX){
+    entry->in_flight ++;
+  }
+}
+
+void
+ndn_measurements_estimate_rtt(uint32_t* srtt, uint32_t* rttvar, uint32_t rtt){
+  uint32_t diff;
+
+  if(rtt == 0){
+    rtt = 1;
+  }
+  if(*srtt == 0){
+    *srtt = rtt;
+    *rttvar = rtt / 2;
+  }else{
+    diff = (*srtt > rtt ? *srtt - rtt : rtt - *srtt);
+    *rttvar = *rttvar - *rttvar / 4 + diff / 4;
+    *srtt = *srtt - *srtt / 8 + rtt / 8;
+  }
+}
+
+void
+ndn_measurements_on_data(ndn_measurements_t* self,
+                         ndn_table_id_t nametree_id,
+                         ndn_table_id_t face_id,
+                         uint32_t rtt)
+{
+  ndn_measurements_entry_t* entry = ndn_measurements_find(self, nametree_id, face_id);
+
+  if(entry == NULL){
+    return;
+  }
+  ndn_measurements_estimate_rtt(&entry->srtt, &entry->rttvar, rtt);
+  entry->satisfaction = entry->satisfaction - entry->satisfaction / 8 + 1000 / 8;
+}
+
+void
+ndn_measurements_on_timeout(ndn_measurements_t* self,
+                            ndn_table_id_t nametree_id,
+                            const ndn_faceset_t* faces)
+{
+  ndn_faceset_t rest = *faces;
+  ndn_measurements_entry_t* entry;
+
+  while(!faceset_empty(&rest)){
+    entry = ndn_measurements_find(self, nametree_id, faceset_pop_least(&rest));
+    if(entry != NULL){
+      entry->satisfaction -= entry->satisfaction / 8;
+    }
+  }
+}
+
+void
+ndn_measurements_on_finish(ndn_measurements_t* self,
+                           ndn_table_id_t nametree_id,
+                           const ndn_faceset_t* faces)
+{
+  ndn_faceset_t rest = *faces;
+  ndn_measurements_entry_t* entry;
+
+  while(!faceset_empty(&rest)){
+    entry = ndn_measurements_find(self, nametree_id, faceset_pop_least(&rest));
+    if(entry != NULL && entry->in_flight > 0){
+      entry->in_flight --;
+    }
+  }
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef FORWARDER_MEASUREMENTS_H_
+#define FORWARDER_MEASUREMENTS_H_
+
+#include "../util/bit-operations.h"
+#include "../util/uniform-time.h"
+#include "face-table.h"
+#include "name-tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup NDNFwdMeasurements Measurements
+ * @brief Measurements Table
+ *
+ * Statistics of Interests forwarded under a FIB prefix through a face.
+ * Entries hang off the NameTree node of the prefix, and are evicted in LRU order.
+ * @ingroup NDNFwd
+ * @{
+ */
+
+/**
+ * Measurements entry of a (prefix, face) pair.
+ */
+typedef struct ndn_measurements_entry {
+  /** Smoothed round-trip time in milliseconds.
+   * 0 if not measured yet.
+   */
+  uint32_t srtt;
+
+  /** Round-trip time variation in milliseconds.
+   */
+  uint32_t rttvar;
+
+  /** Moving average of the ratio of Interests satisfied, in 1/1000.
+   * Starts from 1000.
+   */
+  uint16_t satisfaction;
+
+  /** Number of Interests sent and not yet satisfied or expired.
+   */
+  uint16_t in_flight;
+
+  /** The ndn_face_table#epoch when the entry was created for its face.
+   * The statistics start over if the face ID is given to another face afterwards.
+   */
+  uint32_t face_epoch;
+
+  /** The face.
+   */
+  ndn_table_id_t face_id;
+
+  /** NameTree entry's ID of the prefix.
+   * #NDN_INVALID_ID if the entry is empty.
+   */
+  ndn_table_id_t nametree_id;
+
+  /** The next entry of the same prefix.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t sibling;
+
+  /** Previous entry in the LRU list, i.e. the one used more recently.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t prev;
+
+  /** Next entry in the LRU list, i.e. the one used less recently.
+   * For a free entry, it is the next free entry.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t next;
+} ndn_measurements_entry_t;
+
+/**
+ * Measurements Table.
+ */
+typedef struct ndn_measurements {
+  ndn_nametree_t* nametree;
+
+  /** FaceTable telling whether the face of an entry has been unregistered.
+   * Set by the forwarder. @c NULL if faces are never unregistered.
+   */
+  const ndn_face_table_t* facetab;
+
+  ndn_table_id_t capacity;
+
+  /** The most recently used entry.
+   */
+  ndn_table_id_t lru_head;
+
+  /** The least recently used entry, evicted first.
+   */
+  ndn_table_id_t lru_tail;
+
+  /** The first free entry.
+   */
+  ndn_table_id_t free_head;
+
+  ndn_measurements_entry_t slots[];
+} ndn_measurements_t;
+
+#define NDN_MEASUREMENTS_RESERVE_SIZE(entry_count) \
+  (sizeof(ndn_measurements_t) + sizeof(ndn_measurements_entry_t) * (entry_count))
+
+void
+ndn_measurements_init(void* memory, ndn_table_id_t capacity, ndn_nametree_t* nametree);
+
+/** Find the entry of a (prefix, face) pair.
+ * @param[in] self Measurements Table.
+ * @param[in] nametree_id NameTree entry's ID of the prefix.
+ * @param[in] face_id The face.
+ * @return The entry. @c NULL if none, or if it was made for a face unregistered since.
+ */
+ndn_measurements_entry_t*
+ndn_measurements_find(ndn_measurements_t* self, ndn_table_id_t nametree_id, ndn_table_id_t face_id);
+
+/** An Interest is sent under a prefix through a face.
+ *
+ * Creates the entry if none, evicting the least recently used one if full.
+ * @param[in, out] self Measurements Table.
+ * @param[in] nametree_id NameTree entry's ID of the prefix, which must be referenced.
+ * @param[in] face_id The face.
+ */
+void
+ndn_measurements_on_send(ndn_measurements_t* self, ndn_table_id_t nametree_id, ndn_table_id_t face_id);
+
+/** Update a round-trip time estimate with a new sample.
+ *
+ * Follows RFC 6298, with gains of 1/8 and 1/4.
+ * @param[in, out] srtt Smoothed RTT in milliseconds. 0 if not measured yet.
+ * @param[in, out] rttvar RTT variation in milliseconds.
+ * @param[in] rtt The sample in milliseconds, counted as 1 if 0.
+ */
+void
+ndn_measurements_estimate_rtt(uint32_t* srtt, uint32_t* rttvar, uint32_t rtt);
+
+/** Data is received for an Interest sent under a prefix.
+ * @param[in, out] self Measurements Table.
+ * @param[in] nametree_id NameTree entry's ID of the prefix.
+ * @param[in] face_id The face the Data came from.
+ * @param[in] rtt The round-trip time in milliseconds.
+ */
+void
+ndn_measurements_on_data(ndn_measurements_t* self,
+                         ndn_table_id_t nametree_id,
+                         ndn_table_id_t face_id,
+                         uint32_t rtt);
+
+/** An Interest sent under a prefix expired without Data.
+ * @param[in, out] self Measurements Table.
+ * @param[in] nametree_id NameTree entry's ID of the prefix.
+ * @param[in] faces The faces the Interest was sent to.
+ */
+void
+ndn_measurements_on_timeout(ndn_measurements_t* self,
+                            ndn_table_id_t nametree_id,
+                            const ndn_faceset_t* faces);
+
+/** An Interest sent under a prefix leaves the PIT, for any reason.
+ * @param[in, out] self Measurements Table.
+ * @param[in] nametree_id NameTree entry's ID of the prefix.
+ * @param[in] faces The faces the Interest was sent to.
+ */
+void
+ndn_measurements_on_finish(ndn_measurements_t* self,
+                           ndn_table_id_t nametree_id,
+                           const ndn_faceset_t* faces);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FORWARDER_MEASUREMENTS_H_
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "name-arena.h"
+#include <string.h>
+#include "../encode/forwarder-helper.h"
+
+#define minof2(a, b) ((a) < (b) ? (a) : (b))
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#define NAME_ARENA_VECTOR 1
+#elif defined(__GNUC__) && defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define NAME_ARENA_VECTOR 1
+#endif
+
+#ifdef NAME_ARENA_VECTOR
+/** Compare @c width bytes in one vector op.
+ * @return 0 if equal. Otherwise the lowest set bit marks the first differing byte,
+ *         at 1 bit per byte on x86 and 4 bits per byte on ARM.
+ */
+static inline uint64_t
+name_arena_vector_diff(const uint8_t* a, const uint8_t* b, size_t width)
+{
+#if defined(__SSE2__)
+  __m128i eq;
+#if defined(__AVX2__)
+  if (width == 32) {
+    return (uint32_t)~_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)a),
+                        _mm256_loadu_si256((const __m256i*)b)));
+  }
+#endif
+  (void)width;
+  eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)a), _mm_loadu_si128((const __m128i*)b));
+  return (uint16_t)~_mm_movemask_epi8(eq);
+#else
+  // NEON has no movemask. Shifting every 16-bit lane right by 4 and
+  // narrowing it leaves one nibble per byte.
+  uint8x16_t eq = vceqq_u8(vld1q_u8(a), vld1q_u8(b));
+  (void)width;
+  return ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+#endif
+}
+
+static inline size_t
+name_arena_vector_first(uint64_t diff)
+{
+#if defined(__SSE2__)
+  return (size_t)__builtin_ctzll(diff);
+#else
+  return (size_t)__builtin_ctzll(diff) >> 2;
+#endif
+}
+
+/** Compare @c len bytes, @c width at a time, where <tt>len >= width</tt>.
+ *
+ * The last load overlaps the previous one instead of running past the end,
+ * since @c a points into a packet that may end right after the component.
+ */
+static inline int
+name_arena_vector_compare(const uint8_t* a, const uint8_t* b, size_t len, size_t width)
+{
+  size_t i = 0;
+  uint64_t diff;
+
+  while (true) {
+    diff = name_arena_vector_diff(a + i, b + i, width);
+    if (diff != 0) {
+      i += name_arena_vector_first(diff);
+      return (int)a[i] - (int)b[i];
+    }
+    if (i + width == len) {
+      return 0;
+    }
+    i = minof2(i + width, len - width);
+  }
+}
+
+/** Compare 8 to 16 bytes as two overlapping little-endian words.
+ */
+static inline int
+name_arena_word_compare(const uint8_t* a, const uint8_t* b, size_t len)
+{
+  uint64_t x, y;
+  size_t i = 0;
+
+  memcpy(&x, a, 8);
+  memcpy(&y, b, 8);
+  if (x == y) {
+    i = len - 8;
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    if (x == y) {
+      return 0;
+    }
+  }
+  i += (size_t)__builtin_ctzll(x ^ y) >> 3;
+  return (int)a[i] - (int)b[i];
+}
+#endif
+
+/** @c memcmp for the blocks of a component, which are shorter than 64 bytes.
+ *
+ * The vector kernels are picked at compile time, e.g. by @c -mavx2.
+ * Components shorter than a word are left to @c memcmp, and so are blocks
+ * needing several 16-byte compares without AVX2, which benchmark/name-arena-bench
+ * measured no faster than @c memcmp.
+ */
+static inline int
+name_arena_memcmp(const uint8_t* a, const uint8_t* b, size_t len)
+{
+#ifdef NAME_ARENA_VECTOR
+#if defined(__AVX2__)
+  if (len >= 32) {
+    return name_arena_vector_compare(a, b, len, 32);
+  }
+  if (len >= 16) {
+    return name_arena_vector_compare(a, b, len, 16);
+  }
+#else
+  if (len == 16) {
+    return name_arena_vector_compare(a, b, len, 16);
+  }
+  if (len > 16) {
+    return memcmp(a, b, len);
+  }
+#endif
+  if (len >= 8) {
+    return name_arena_word_compare(a, b, len);
+  }
+#endif
+  return memcmp(a, b, len);
+}
+
+void
+ndn_name_arena_init(ndn_name_arena_t* self, void* memory, ndn_table_id_t entry_count)
+{
+  ndn_table_id_t i;
+
+  self->blocks = (ndn_name_arena_block_t*)memory;
+  self->capacity = NDN_NAME_ARENA_BLOCK_COUNT(entry_count);
+  for (i = 0; i < self->capacity; i ++) {
+    self->blocks[i].next = i + 1;
+  }
+  self->blocks[self->capacity - 1].next = NDN_INVALID_ID;
+  self->free_head = 0;
+}
+
+void
+ndn_name_arena_free(ndn_name_arena_t* self, ndn_table_id_t ext)
+{
+  ndn_table_id_t next;
+  while (ext != NDN_INVALID_ID) {
+    next = self->blocks[ext].next;
+    self->blocks[ext].next = self->free_head;
+    self->free_head = ext;
+    ext = next;
+  }
+}
+
+bool
+ndn_name_arena_store(ndn_name_arena_t* self, uint8_t* val, ndn_table_id_t* ext,
+                     const uint8_t* comp, size_t len)
+{
+  ndn_table_id_t* link = ext;
+  ndn_table_id_t id;
+  size_t seg;
+
+  *ext = NDN_INVALID_ID;
+  if (len > NDN_NAME_MAX_BLOCK_SIZE) {
+    return false;
+  }
+  seg = minof2(len, NDN_NAME_COMPONENT_BLOCK_SIZE);
+  memcpy(val, comp, seg);
+  comp += seg;
+  len -= seg;
+
+  while (len > 0) {
+    id = self->free_head;
+    if (id == NDN_INVALID_ID) {
+      ndn_name_arena_free(self, *ext);
+      *ext = NDN_INVALID_ID;
+      return false;
+    }
+    self->free_head = self->blocks[id].next;
+    self->blocks[id].next = NDN_INVALID_ID;
+    seg = minof2(len, NDN_NAME_ARENA_BLOCK_SIZE);
+    memcpy(self->blocks[id].val, comp, seg);
+    comp += seg;
+    len -= seg;
+    *link = id;
+    link = &self->blocks[id].next;
+  }
+  return true;
+}
+
+int
+ndn_name_arena_compare(ndn_name_arena_t* self, const uint8_t* comp, size_t len,
+                       const uint8_t* val, ndn_table_id_t ext)
+{
+  size_t seg = minof2(len, NDN_NAME_COMPONENT_BLOCK_SIZE);
+  int ret = name_arena_memcmp(comp, val, seg);
+
+  if (ret != 0) {
+    return ret;
+  }
+  // Two TLV components with equal type and length bytes have equal sizes,
+  // so a difference is always found before either one ends.
+  comp += seg;
+  len -= seg;
+  while (len > 0) {
+    if (ext == NDN_INVALID_ID) {
+      return 1;
+    }
+    seg = minof2(len, NDN_NAME_ARENA_BLOCK_SIZE);
+    ret = name_arena_memcmp(comp, self->blocks[ext].val, seg);
+    if (ret != 0) {
+      return ret;
+    }
+    comp += seg;
+    len -= seg;
+    ext = self->blocks[ext].next;
+  }
+  return ext == NDN_INVALID_ID ? 0 : -1;
+}
+
+size_t
+ndn_name_arena_load(ndn_name_arena_t* self, const uint8_t* val, ndn_table_id_t ext, uint8_t* buf)
+{
+  uint32_t type, varlen;
+  uint8_t* ptr;
+  size_t len, seg, ret;
+
+  ptr = tlv_get_type_length((uint8_t*)val, NDN_NAME_COMPONENT_BLOCK_SIZE, &type, &varlen);
+  if (ptr == NULL) {
+    return 0;
+  }
+  ret = len = minof2((ptr - val) + varlen, NDN_NAME_MAX_BLOCK_SIZE);
+  seg = minof2(len, NDN_NAME_COMPONENT_BLOCK_SIZE);
+  memcpy(buf, val, seg);
+  buf += seg;
+  len -= seg;
+  while (len > 0 && ext != NDN_INVALID_ID) {
+    seg = minof2(len, NDN_NAME_ARENA_BLOCK_SIZE);
+    memcpy(buf, self->blocks[ext].val, seg);
+    buf += seg;
+    len -= seg;
+    ext = self->blocks[ext].next;
+  }
+  return ret;
+}
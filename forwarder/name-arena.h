@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef FORWARDER_NAME_ARENA_H
+#define FORWARDER_NAME_ARENA_H
+
+#include "../ndn-constants.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup NDNFwdNameArena Name Component Arena
+ * @brief Storage of long name components for NameTree.
+ *
+ * A NameTree node keeps the first #NDN_NAME_COMPONENT_BLOCK_SIZE bytes of its
+ * component inline. The rest of a longer component is kept in a chain of
+ * fixed-size blocks allocated from an arena owned by the NameTree.
+ * @ingroup NDNFwd
+ * @{
+ */
+
+/** Bytes of a component held by one arena block.
+ */
+#define NDN_NAME_ARENA_BLOCK_SIZE 30
+
+/** The number of arena blocks reserved for a NameTree.
+ * @param[in] entry_count Maximum number of NameTree nodes.
+ */
+#define NDN_NAME_ARENA_BLOCK_COUNT(entry_count) ((entry_count) / 4 + 1)
+
+typedef struct ndn_name_arena_block{
+  /** The next block of the same component.
+   * For a free block, it is the next free block.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t next;
+  uint8_t val[NDN_NAME_ARENA_BLOCK_SIZE];
+} ndn_name_arena_block_t;
+
+typedef struct ndn_name_arena{
+  ndn_name_arena_block_t* blocks;
+  ndn_table_id_t capacity;
+  ndn_table_id_t free_head;
+} ndn_name_arena_t;
+
+/** The memory reserved for the blocks of an arena.
+ * @param[in] entry_count Maximum number of NameTree nodes.
+ */
+#define NDN_NAME_ARENA_RESERVE_SIZE(entry_count) \
+  (sizeof(ndn_name_arena_block_t) * NDN_NAME_ARENA_BLOCK_COUNT(entry_count))
+
+/** Initialize an arena.
+ * @param[out] self The arena.
+ * @param[in] memory Memory for the blocks, in size #NDN_NAME_ARENA_RESERVE_SIZE.
+ * @param[in] entry_count Maximum number of NameTree nodes.
+ */
+void
+ndn_name_arena_init(ndn_name_arena_t* self, void* memory, ndn_table_id_t entry_count);
+
+/** Store a name component.
+ * @param[in, out] self The arena.
+ * @param[out] val The inline buffer in size #NDN_NAME_COMPONENT_BLOCK_SIZE.
+ * @param[out] ext The first arena block used. #NDN_INVALID_ID if none.
+ * @param[in] comp The component, including its type and length.
+ * @param[in] len The length of @c comp.
+ * @return Whether the component is stored. @c false if the arena is full
+ *         or @c comp is longer than #NDN_NAME_MAX_BLOCK_SIZE.
+ */
+bool
+ndn_name_arena_store(ndn_name_arena_t* self, uint8_t* val, ndn_table_id_t* ext,
+                     const uint8_t* comp, size_t len);
+
+/** Free the arena blocks of a component.
+ * @param[in, out] self The arena.
+ * @param[in] ext The first arena block. #NDN_INVALID_ID if none.
+ */
+void
+ndn_name_arena_free(ndn_name_arena_t* self, ndn_table_id_t ext);
+
+/** Compare a name component with a stored one in the way of @c memcmp.
+ *
+ * Uses SSE2, AVX2 or NEON when the compiler targets them.
+ * @param[in] self The arena.
+ * @param[in] comp The component to compare.
+ * @param[in] len The length of @c comp.
+ * @param[in] val The inline part of the stored component.
+ * @param[in] ext The first arena block of the stored component.
+ * @return 0 if equal. The sign tells the order otherwise.
+ */
+int
+ndn_name_arena_compare(ndn_name_arena_t* self, const uint8_t* comp, size_t len,
+                       const uint8_t* val, ndn_table_id_t ext);
+
+/** Copy a stored component into a continuous buffer.
+ * @param[in] self The arena.
+ * @param[in] val The inline part of the stored component.
+ * @param[in] ext The first arena block of the stored component.
+ * @param[out] buf The output buffer, in size #NDN_NAME_MAX_BLOCK_SIZE.
+ * @return The length of the component.
+ */
+size_t
+ndn_name_arena_load(ndn_name_arena_t* self, const uint8_t* val, ndn_table_id_t ext, uint8_t* buf);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FORWARDER_NAME_ARENA_H
@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifdef NDN_NAMETREE_HASH
+
+#include "name-hash.h"
+#include <stdbool.h>
+
+#define NAMETREE_ROOT 0
+
+#if defined(__GNUC__)
+#define NAMETREE_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define NAMETREE_PREFETCH(addr) ((void)(addr))
+#endif
+
+#define NAMETREE_BUCKETS(self) ((ndn_table_id_t*)&(self)->pool[(self)->capacity])
+
+static inline uint32_t
+nametree_home(ndn_nametree_t *self, uint32_t hash, uint16_t depth)
+{
+  return (hash ^ ((uint32_t)depth * 0x9E3779B1u)) % self->bucket_cnt;
+}
+
+static inline bool
+nametree_node_match(ndn_nametree_t *self,
+                    nametree_entry_t* node,
+                    uint32_t hash,
+                    uint16_t depth,
+                    uint8_t* comp,
+                    size_t comp_len)
+{
+  return node->hash == hash && node->depth == depth &&
+         ndn_name_arena_compare(&self->arena, comp, comp_len, node->val, node->ext) == 0;
+}
+
+/** Find a node by its prefix.
+ * @param parent The parent node to check. #NDN_INVALID_ID to skip the check.
+ */
+static ndn_table_id_t
+nametree_lookup(ndn_nametree_t *self,
+                ndn_table_id_t parent,
+                uint32_t hash,
+                uint16_t depth,
+                uint8_t* comp,
+                size_t comp_len)
+{
+  ndn_table_id_t* buckets = NAMETREE_BUCKETS(self);
+  uint32_t pos = nametree_home(self, hash, depth);
+  ndn_table_id_t id;
+
+  while ((id = buckets[pos]) != NDN_INVALID_ID) {
+    if ((parent == NDN_INVALID_ID || self->pool[id].parent == parent) &&
+        nametree_node_match(self, &self->pool[id], hash, depth, comp, comp_len)) {
+      return id;
+    }
+    pos = (pos + 1 == self->bucket_cnt) ? 0 : pos + 1;
+  }
+  return NDN_INVALID_ID;
+}
+
+static void
+nametree_bucket_insert(ndn_nametree_t *self, ndn_table_id_t id)
+{
+  ndn_table_id_t* buckets = NAMETREE_BUCKETS(self);
+  uint32_t pos = nametree_home(self, self->pool[id].hash, self->pool[id].depth);
+
+  while (buckets[pos] != NDN_INVALID_ID) {
+    pos = (pos + 1 == self->bucket_cnt) ? 0 : pos + 1;
+  }
+  buckets[pos] = id;
+}
+
+static void
+nametree_bucket_remove(ndn_nametree_t *self, ndn_table_id_t id)
+{
+  ndn_table_id_t* buckets = NAMETREE_BUCKETS(self);
+  uint32_t hole = nametree_home(self, self->pool[id].hash, self->pool[id].depth);
+  uint32_t pos, home;
+
+  while (buckets[hole] != id) {
+    hole = (hole + 1 == self->bucket_cnt) ? 0 : hole + 1;
+  }
+  // Backward shift deletion: move back following entries which can fill the hole
+  pos = hole;
+  while (true) {
+    pos = (pos + 1 == self->bucket_cnt) ? 0 : pos + 1;
+    if (buckets[pos] == NDN_INVALID_ID) {
+      break;
+    }
+    home = nametree_home(self, self->pool[buckets[pos]].hash, self->pool[buckets[pos]].depth);
+    if (hole <= pos ? (hole < home && home <= pos) : (hole < home || home <= pos)) {
+      continue;
+    }
+    buckets[hole] = buckets[pos];
+    hole = pos;
+  }
+  buckets[hole] = NDN_INVALID_ID;
+}
+
+static void
+nametree_reset_node(nametree_entry_t* node, ndn_table_id_t next_free)
+{
+  node->hash = NDN_NAME_HASH_SEED;
+  node->depth = 0;
+  node->ext = NDN_INVALID_ID;
+  node->parent = next_free;
+  node->first_child = NDN_INVALID_ID;
+  node->next_sibling = NDN_INVALID_ID;
+  node->prev_sibling = NDN_INVALID_ID;
+  node->ref_cnt = 0;
+  node->pit_id = NDN_INVALID_ID;
+  node->fib_id = NDN_INVALID_ID;
+  node->cs_id = NDN_INVALID_ID;
+  node->measurements_id = NDN_INVALID_ID;
+}
+
+/** Free a node and its ancestors until one is still referenced.
+ */
+static void
+nametree_reclaim(ndn_nametree_t *self, ndn_table_id_t id)
+{
+  ndn_table_id_t parent, prev, next;
+  while (id != NAMETREE_ROOT && self->pool[id].ref_cnt == 0) {
+    parent = self->pool[id].parent;
+    prev = self->pool[id].prev_sibling;
+    next = self->pool[id].next_sibling;
+    if (prev == NDN_INVALID_ID) {
+      self->pool[parent].first_child = next;
+    } else {
+      self->pool[prev].next_sibling = next;
+    }
+    if (next != NDN_INVALID_ID) {
+      self->pool[next].prev_sibling = prev;
+    }
+    nametree_bucket_remove(self, id);
+    ndn_name_arena_free(&self->arena, self->pool[id].ext);
+    nametree_reset_node(&self->pool[id], self->free_head);
+    self->free_head = id;
+    self->pool[parent].ref_cnt --;
+    id = parent;
+  }
+}
+
+void
+ndn_nametree_init(void* memory, ndn_table_id_t capacity)
+{
+  ndn_nametree_t *self = (ndn_nametree_t*)memory;
+  ndn_table_id_t i;
+  uint32_t j;
+
+  self->capacity = capacity;
+  self->bucket_cnt = NDN_NAMETREE_HASH_BUCKET_COUNT(capacity);
+  for (j = 0; j < self->bucket_cnt; j ++) {
+    NAMETREE_BUCKETS(self)[j] = NDN_INVALID_ID;
+  }
+  ndn_name_arena_init(&self->arena, &NAMETREE_BUCKETS(self)[self->bucket_cnt], capacity);
+
+  // All free nodes are linked by parent
+  nametree_reset_node(&self->pool[NAMETREE_ROOT], NDN_INVALID_ID);
+  for (i = 1; i < capacity; i ++) {
+    nametree_reset_node(&self->pool[i], i + 1);
+  }
+  if (capacity > 1) {
+    self->pool[capacity - 1].parent = NDN_INVALID_ID;
+    self->free_head = 1;
+  } else {
+    self->free_head = NDN_INVALID_ID;
+  }
+}
+
+static ndn_table_id_t
+nametree_create_node(ndn_nametree_t *self,
+                     ndn_table_id_t parent,
+                     uint32_t hash,
+                     uint16_t depth,
+                     uint8_t* comp,
+                     size_t comp_len)
+{
+  ndn_table_id_t id = self->free_head;
+  nametree_entry_t* node;
+
+  if (id == NDN_INVALID_ID) {
+    return NDN_INVALID_ID;
+  }
+  node = &self->pool[id];
+  if (!ndn_name_arena_store(&self->arena, node->val, &node->ext, comp, comp_len)) {
+    return NDN_INVALID_ID;
+  }
+  self->free_head = node->parent;
+
+  node->parent = parent;
+  node->prev_sibling = NDN_INVALID_ID;
+  node->next_sibling = self->pool[parent].first_child;
+  if (node->next_sibling != NDN_INVALID_ID) {
+    self->pool[node->next_sibling].prev_sibling = id;
+  }
+  self->pool[parent].first_child = id;
+  node->ref_cnt = 0;
+  node->hash = hash;
+  node->depth = depth;
+  nametree_bucket_insert(self, id);
+  self->pool[parent].ref_cnt ++;
+  return id;
+}
+
+/** Walk down the tree component by component.
+ * @param create Create missing nodes if true.
+ * @param exact If not @c NULL, stop at the deepest existing node instead of failing,
+ *              and set to whether it is the node of @c name.
+ * @return The node of @c name if @c exact is @c NULL.
+ *         The node of the longest existing prefix otherwise.
+ */
+static nametree_entry_t*
+nametree_walk(ndn_nametree_t *self,
+              const ndn_parsed_name_t* name,
+              bool create,
+              bool* exact)
+{
+  uint16_t depth;
+  ndn_table_id_t cur = NAMETREE_ROOT, next;
+
+  for (depth = 1; depth <= name->count; depth ++) {
+    next = nametree_lookup(self, cur, name->hashes[depth], depth,
+                           ndn_parsed_name_component(name, depth - 1),
+                           ndn_parsed_name_component_size(name, depth - 1));
+    if (next == NDN_INVALID_ID && create) {
+      next = nametree_create_node(self, cur, name->hashes[depth], depth,
+                                  ndn_parsed_name_component(name, depth - 1),
+                                  ndn_parsed_name_component_size(name, depth - 1));
+      if (next == NDN_INVALID_ID) {
+        // Give back nodes created by this call
+        nametree_reclaim(self, cur);
+      }
+    }
+    if (next == NDN_INVALID_ID) {
+      if (exact == NULL) {
+        return NULL;
+      }
+      *exact = false;
+      return &self->pool[cur];
+    }
+    cur = next;
+  }
+  if (exact != NULL) {
+    *exact = true;
+  }
+  return &self->pool[cur];
+}
+
+nametree_entry_t*
+ndn_nametree_find_or_insert(ndn_nametree_t *self, const ndn_parsed_name_t* name)
+{
+  return nametree_walk(self, name, true, NULL);
+}
+
+void
+ndn_nametree_ref(ndn_nametree_t *self, nametree_entry_t* entry)
+{
+  (void)self;
+  entry->ref_cnt ++;
+}
+
+void
+ndn_nametree_unref(ndn_nametree_t *self, nametree_entry_t* entry)
+{
+  entry->ref_cnt --;
+  nametree_reclaim(self, ndn_nametree_getid(self, entry));
+}
+
+void
+ndn_nametree_release(ndn_nametree_t *self, nametree_entry_t* entry)
+{
+  nametree_reclaim(self, ndn_nametree_getid(self, entry));
+}
+
+nametree_entry_t*
+ndn_nametree_find(ndn_nametree_t *self, const ndn_parsed_name_t* name)
+{
+  return nametree_walk(self, name, false, NULL);
+}
+
+nametree_entry_t*
+ndn_nametree_longest_prefix(ndn_nametree_t *self, const ndn_parsed_name_t* name, bool* exact)
+{
+  uint16_t lo, hi, mid, depth;
+  ndn_table_id_t best = NAMETREE_ROOT, id;
+
+  // All ancestors of a node exist, so the longest existing prefix can be binary searched
+  lo = 0;
+  hi = name->count;
+  while (lo < hi) {
+    mid = (lo + hi + 1) / 2;
+    id = nametree_lookup(self, NDN_INVALID_ID, name->hashes[mid], mid,
+                         ndn_parsed_name_component(name, mid - 1),
+                         ndn_parsed_name_component_size(name, mid - 1));
+    if (id != NDN_INVALID_ID) {
+      lo = mid;
+      best = id;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  // Probes above didn't check parents, so verify the whole path once
+  for (id = best, depth = lo; depth > 0; id = self->pool[id].parent, depth --) {
+    if (!nametree_node_match(self, &self->pool[id], name->hashes[depth], depth,
+                             ndn_parsed_name_component(name, depth - 1),
+                             ndn_parsed_name_component_size(name, depth - 1))) {
+      return nametree_walk(self, name, false, exact);
+    }
+  }
+
+  *exact = (lo == name->count);
+  return &self->pool[best];
+}
+
+nametree_entry_t*
+ndn_nametree_prefix_match(
+  ndn_nametree_t *self,
+  const ndn_parsed_name_t* name,
+  enum NDN_NAMETREE_ENTRY_TYPE entry_type)
+{
+  nametree_entry_t* node;
+  ndn_table_id_t id;
+  bool exact;
+
+  node = ndn_nametree_longest_prefix(self, name, &exact);
+  for (id = ndn_nametree_getid(self, node); id != NDN_INVALID_ID; id = self->pool[id].parent) {
+    if (entry_type == NDN_NAMETREE_FIB_TYPE && self->pool[id].fib_id != NDN_INVALID_ID) {
+      return &self->pool[id];
+    }
+    if (entry_type == NDN_NAMETREE_PIT_TYPE && self->pool[id].pit_id != NDN_INVALID_ID) {
+      return &self->pool[id];
+    }
+  }
+  return NULL;
+}
+
+void
+ndn_nametree_prefetch(ndn_nametree_t *self, const ndn_parsed_name_t* name)
+{
+  uint16_t depth;
+
+  // The home bucket of every prefix, which the walk probes first
+  for (depth = 1; depth <= name->count; depth ++) {
+    NAMETREE_PREFETCH(&NAMETREE_BUCKETS(self)[nametree_home(self, name->hashes[depth], depth)]);
+  }
+}
+
+nametree_entry_t*
+ndn_nametree_search_subtree(ndn_nametree_t *self, nametree_entry_t* entry,
+                            ndn_nametree_visit_t visit, void* ctx)
+{
+  ndn_table_id_t top = ndn_nametree_getid(self, entry);
+  ndn_table_id_t id = entry->first_child;
+
+  // Depth-first by the child and sibling links, climbing back by parent
+  while (id != NDN_INVALID_ID) {
+    if (visit(ctx, &self->pool[id])) {
+      return &self->pool[id];
+    }
+    if (self->pool[id].first_child != NDN_INVALID_ID) {
+      id = self->pool[id].first_child;
+      continue;
+    }
+    while (id != top && self->pool[id].next_sibling == NDN_INVALID_ID) {
+      id = self->pool[id].parent;
+    }
+    id = (id == top) ? NDN_INVALID_ID : self->pool[id].next_sibling;
+  }
+  return NULL;
+}
+
+nametree_entry_t*
+ndn_nametree_at(ndn_nametree_t *self, ndn_table_id_t id)
+{
+  return &self->pool[id];
+}
+
+ndn_table_id_t
+ndn_nametree_getid(ndn_nametree_t *self, nametree_entry_t* entry)
+{
+  return entry - self->pool;
+}
+
+#endif // NDN_NAMETREE_HASH
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef FORWARDER_NAME_HASH_H
+#define FORWARDER_NAME_HASH_H
+
+#include "../ndn-constants.h"
+#include "name-arena.h"
+#include "parsed-name.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup NDNFwdNameHash Hash Name Tree
+ * @brief Name Tree indexed by a hash table of prefixes.
+ *
+ * Each node is located by the hash of its prefix and the prefix length,
+ * so an exact match takes one probe per component.
+ * Longest prefix match takes a binary search over the prefix length.
+ * Enabled by defining @c NDN_NAMETREE_HASH.
+ * @ingroup NDNFwd
+ * @{
+ */
+
+enum NDN_NAMETREE_ENTRY_TYPE{
+  NDN_NAMETREE_FIB_TYPE,
+  NDN_NAMETREE_PIT_TYPE,
+
+  NDN_NAMETREE_ENTRY_TYPE_CNT
+};
+
+/**
+ * NameTree node.
+ */
+typedef struct nametree_entry{
+  /**
+   * Hash of the prefix ending at this node, as in ndn_parsed_name#hashes.
+   */
+  uint32_t hash;
+
+  /**
+   * Name component of this node.
+   * Only the first #NDN_NAME_COMPONENT_BLOCK_SIZE bytes of a longer component.
+   */
+  uint8_t val[NDN_NAME_COMPONENT_BLOCK_SIZE];
+
+  /**
+   * Number of components of the prefix, i.e. the depth of this node.
+   * Packed right after @c val, so the node has no padding.
+   */
+  uint16_t depth;
+
+  /**
+   * Arena blocks holding the rest of a long component.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t ext;
+
+  /**
+   * Parent node.
+   * For a free node, it is the next free node.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t parent;
+
+  /**
+   * A child of this node, in no particular order.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t first_child;
+
+  /**
+   * The next child of the parent.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t next_sibling;
+
+  /**
+   * The previous child of the parent, so a freed node is unlinked in constant time.
+   * #NDN_INVALID_ID if this node is the parent's @c first_child.
+   */
+  ndn_table_id_t prev_sibling;
+
+  /**
+   * Number of children and table entries referring to this node.
+   * The node is freed when it drops to 0.
+   */
+  ndn_table_id_t ref_cnt;
+
+  /**
+   * Corresponding PIT entry's id.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t pit_id;
+
+  /**
+   * Corresponding FIB entry's id.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t fib_id;
+
+  /**
+   * Corresponding CS entry's id.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t cs_id;
+
+  /**
+   * First Measurements entry of this prefix.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t measurements_id;
+} nametree_entry_t;
+
+typedef struct ndn_nametree{
+  ndn_table_id_t capacity;
+
+  /**
+   * The first free node.
+   */
+  ndn_table_id_t free_head;
+
+  /**
+   * Number of buckets of the open-addressing hash table, stored right after @c pool.
+   */
+  uint32_t bucket_cnt;
+
+  /**
+   * Storage of long components, whose blocks follow the buckets.
+   */
+  ndn_name_arena_t arena;
+
+  /**
+   * All nodes. @c pool[0] is the root node "/".
+   */
+  nametree_entry_t pool[];
+}ndn_nametree_t;
+
+#define NDN_NAMETREE_HASH_BUCKET_COUNT(entry_count) ((uint32_t)(entry_count) * 2)
+
+#define NDN_NAMETREE_RESERVE_SIZE(entry_count) \
+  (sizeof(ndn_nametree_t) + sizeof(nametree_entry_t) * (entry_count) + \
+   sizeof(ndn_table_id_t) * NDN_NAMETREE_HASH_BUCKET_COUNT(entry_count) + \
+   NDN_NAME_ARENA_RESERVE_SIZE(entry_count))
+
+void
+ndn_nametree_init(void* memory, ndn_table_id_t capacity);
+
+nametree_entry_t*
+ndn_nametree_find_or_insert(ndn_nametree_t *self, const ndn_parsed_name_t* name);
+
+void
+ndn_nametree_ref(ndn_nametree_t *self, nametree_entry_t* entry);
+
+void
+ndn_nametree_unref(ndn_nametree_t *self, nametree_entry_t* entry);
+
+void
+ndn_nametree_release(ndn_nametree_t *self, nametree_entry_t* entry);
+
+nametree_entry_t*
+ndn_nametree_find(ndn_nametree_t *self, const ndn_parsed_name_t* name);
+
+/** Find the longest prefix of @c name that has a node.
+ * @param[out] exact Set to whether the node returned is the node of @c name.
+ * @return The node of the longest prefix, the root if none.
+ */
+nametree_entry_t*
+ndn_nametree_longest_prefix(ndn_nametree_t *self, const ndn_parsed_name_t* name, bool* exact);
+
+nametree_entry_t*
+ndn_nametree_prefix_match(
+  ndn_nametree_t *self,
+  const ndn_parsed_name_t* name,
+  enum NDN_NAMETREE_ENTRY_TYPE entry_type);
+
+/** Prefetch the memory a lookup of @c name will touch.
+ *
+ * Called for every packet of a batch before any of them is looked up.
+ */
+void
+ndn_nametree_prefetch(ndn_nametree_t *self, const ndn_parsed_name_t* name);
+
+/** Called on each node by #ndn_nametree_search_subtree.
+ * @return Whether the search stops at this node.
+ */
+typedef bool (*ndn_nametree_visit_t)(void* ctx, nametree_entry_t* node);
+
+/** Search the nodes below @c entry, in no particular order.
+ *
+ * The cost grows with the size of the subtree, not of the whole NameTree.
+ * @c visit must not change the NameTree.
+ * @return The node @c visit stopped at. @c NULL if none.
+ */
+nametree_entry_t*
+ndn_nametree_search_subtree(ndn_nametree_t *self, nametree_entry_t* entry,
+                            ndn_nametree_visit_t visit, void* ctx);
+
+nametree_entry_t*
+ndn_nametree_at(ndn_nametree_t *self, ndn_table_id_t id);
+
+ndn_table_id_t
+ndn_nametree_getid(ndn_nametree_t *self, nametree_entry_t* entry);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FORWARDER_NAME_HASH_H
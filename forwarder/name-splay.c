@@ -6,29 +6,41 @@
  * directory for more details.
  */
 
+#ifdef NDN_NAMETREE_SPLAY
+
 #include "name-splay.h"
 #include <stdbool.h>
 #include <string.h>
-#include "../encode/forwarder-helper.h"
 
 #define LEFT  0
 #define RIGHT 1
 
+#if defined(__GNUC__)
+#define NAMETREE_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define NAMETREE_PREFETCH(addr) ((void)(addr))
+#endif
+
 static void
 nametree_reset_entry(ndn_nametree_t *self,
                       nametree_entry_t* entry,
                       nametree_entry_t* next_unused)
 {
+  entry->ext = NDN_INVALID_ID;
   entry->sub = self->nil;
   entry->cop[LEFT] = self->nil;
   entry->cop[RIGHT] = next_unused;
+  entry->parent = NDN_INVALID_ID;
+  entry->ref_cnt = 0;
   entry->fib_id = NDN_INVALID_ID;
   entry->pit_id = NDN_INVALID_ID;
+  entry->cs_id = NDN_INVALID_ID;
+  entry->measurements_id = NDN_INVALID_ID;
 }
 
 void
 ndn_nametree_init(void* memory, ndn_table_id_t capacity){
-  int i;
+  ndn_table_id_t i;
   ndn_nametree_t *self = (ndn_nametree_t*)memory;
 
   self->nil = &self->pool[0];
@@ -44,6 +56,7 @@ ndn_nametree_init(void* memory, ndn_table_id_t capacity){
     nametree_reset_entry(self, &self->pool[i], &self->pool[i + 1]);
   }
   self->pool[capacity - 1].cop[RIGHT] = self->nil;
+  ndn_name_arena_init(&self->arena, &self->pool[capacity], capacity);
 }
 
 static void
@@ -85,14 +98,15 @@ nametree_finish(ndn_nametree_t* self, nametree_entry_t* par, int dir){
 }
 
 static int
-nametree_splay(ndn_nametree_t* self, nametree_entry_t* par, uint8_t name[], size_t len) {
+nametree_splay(ndn_nametree_t* self, nametree_entry_t* par, const uint8_t name[], size_t len) {
   int dir1, dir2, ret;
   while(true) {
-    ret = memcmp(name, par->sub->val, len);
+    ret = ndn_name_arena_compare(&self->arena, name, len, par->sub->val, par->sub->ext);
     dir1 = ret > 0;
     if (ret == 0 || par->sub->cop[dir1] == self->nil)
       break;
-    ret = memcmp(name, par->sub->cop[dir1]->val, len);
+    ret = ndn_name_arena_compare(&self->arena, name, len,
+                                 par->sub->cop[dir1]->val, par->sub->cop[dir1]->ext);
     dir2 = ret > 0;
     if (ret == 0 || par->sub->cop[dir1]->cop[dir2] == self->nil) {
       nametree_zig(self, par, dir1);
@@ -112,6 +126,7 @@ nametree_splay(ndn_nametree_t* self, nametree_entry_t* par, uint8_t name[], size
 
 static nametree_entry_t*
 nametree_newnode(ndn_nametree_t* self,
+                  nametree_entry_t* par,
                   uint8_t name[],
                   size_t len)
 {
@@ -119,12 +134,19 @@ nametree_newnode(ndn_nametree_t* self,
   if(ret == self->nil){
     return NULL;
   }
+  if(!ndn_name_arena_store(&self->arena, ret->val, &ret->ext, name, len)){
+    return NULL;
+  }
   self->root->cop[RIGHT] = ret->cop[RIGHT];
 
   ret->sub = self->nil;
+  ret->parent = par - self->pool;
+  ret->ref_cnt = 0;
+  par->ref_cnt ++;
   ret->fib_id = NDN_INVALID_ID;
   ret->pit_id = NDN_INVALID_ID;
-  memcpy(ret->val, name, len);
+  ret->cs_id = NDN_INVALID_ID;
+  ret->measurements_id = NDN_INVALID_ID;
 
   return ret;
 }
@@ -143,7 +165,7 @@ nametree_find_or_insert_sub(ndn_nametree_t* self,
   if(compare_ret == 0){
     return oldroot;
   }else{
-    newroot = nametree_newnode(self, name, len);
+    newroot = nametree_newnode(self, par, name, len);
     if(newroot == NULL){
       return NULL;
     }
@@ -157,94 +179,173 @@ nametree_find_or_insert_sub(ndn_nametree_t* self,
 }
 
 nametree_entry_t*
-ndn_nametree_find_or_insert(ndn_nametree_t *self, uint8_t name[], size_t len){
-  uint32_t type, varlen, complen;
-  uint8_t* ptr;
+ndn_nametree_find_or_insert(ndn_nametree_t *self, const ndn_parsed_name_t* name){
   nametree_entry_t* par;
   nametree_entry_t* cur;
+  uint16_t i;
 
-  ptr = tlv_get_type_length(name, len, &type, &varlen);
   par = self->root;
-  while(ptr < name + len){
-    complen = tlv_get_type_length(ptr, name + len - ptr, &type, &varlen) - ptr;
-    complen += varlen;
-    cur = nametree_find_or_insert_sub(self, par, ptr, complen);
+  for(i = 0; i < name->count; i ++){
+    cur = nametree_find_or_insert_sub(self, par, ndn_parsed_name_component(name, i),
+                                      ndn_parsed_name_component_size(name, i));
     if(cur == NULL){
+      // Give back nodes created by this call
+      ndn_nametree_release(self, par);
       return NULL;
     }
     par = cur;
-    ptr += complen;
   }
   return par;
 }
 
-nametree_entry_t*
-ndn_nametree_find(ndn_nametree_t *self, uint8_t name[], size_t len){
-  uint32_t type, varlen, complen;
-  uint8_t* ptr;
+static void
+nametree_remove_node(ndn_nametree_t* self, nametree_entry_t* entry){
+  nametree_entry_t* par = &self->pool[entry->parent];
+  nametree_entry_t* max;
+  uint8_t comp[NDN_NAME_MAX_BLOCK_SIZE];
+  size_t complen;
+
+  // Bring the entry to the root of its level, then join its two subtrees
+  complen = ndn_name_arena_load(&self->arena, entry->val, entry->ext, comp);
+  nametree_splay(self, par, comp, complen);
+  if(entry->cop[LEFT] == self->nil){
+    par->sub = entry->cop[RIGHT];
+  }else{
+    for(max = entry->cop[LEFT]; max->cop[RIGHT] != self->nil; max = max->cop[RIGHT]);
+    max->cop[RIGHT] = entry->cop[RIGHT];
+    par->sub = entry->cop[LEFT];
+  }
+
+  ndn_name_arena_free(&self->arena, entry->ext);
+  nametree_reset_entry(self, entry, self->root->cop[RIGHT]);
+  self->root->cop[RIGHT] = entry;
+  par->ref_cnt --;
+}
+
+void
+ndn_nametree_ref(ndn_nametree_t *self, nametree_entry_t* entry){
+  (void)self;
+  entry->ref_cnt ++;
+}
+
+void
+ndn_nametree_unref(ndn_nametree_t *self, nametree_entry_t* entry){
+  entry->ref_cnt --;
+  ndn_nametree_release(self, entry);
+}
+
+void
+ndn_nametree_release(ndn_nametree_t *self, nametree_entry_t* entry){
+  nametree_entry_t* par;
+  while(entry != self->root && entry->ref_cnt == 0){
+    par = &self->pool[entry->parent];
+    nametree_remove_node(self, entry);
+    entry = par;
+  }
+}
+
+/** Walk down @c name as far as its prefixes exist.
+ * @param[out] depth The number of components walked.
+ * @return The node of the longest existing prefix.
+ */
+static nametree_entry_t*
+nametree_walk(ndn_nametree_t *self, const ndn_parsed_name_t* name, uint16_t* depth){
   nametree_entry_t* par;
-  nametree_entry_t* cur;
   int compare_ret;
+  uint16_t i;
 
-  ptr = tlv_get_type_length(name, len, &type, &varlen);
   par = self->root;
-  while(ptr < name + len){
-    complen = tlv_get_type_length(ptr, name + len - ptr, &type, &varlen) - ptr;
-    complen += varlen;
-    compare_ret = nametree_splay(self, par, ptr, complen);
-    cur = par->sub;
-    if(cur == self->nil || compare_ret != 0){
-      return NULL;
+  for(i = 0; i < name->count; i ++){
+    compare_ret = nametree_splay(self, par, ndn_parsed_name_component(name, i),
+                                 ndn_parsed_name_component_size(name, i));
+    if(par->sub == self->nil || compare_ret != 0){
+      break;
     }
-    par = cur;
-    ptr += complen;
+    par = par->sub;
   }
+  *depth = i;
   return par;
 }
 
+nametree_entry_t*
+ndn_nametree_find(ndn_nametree_t *self, const ndn_parsed_name_t* name){
+  uint16_t depth;
+  nametree_entry_t* ret = nametree_walk(self, name, &depth);
+  return depth == name->count ? ret : NULL;
+}
+
+nametree_entry_t*
+ndn_nametree_longest_prefix(ndn_nametree_t *self, const ndn_parsed_name_t* name, bool* exact){
+  uint16_t depth;
+  nametree_entry_t* ret = nametree_walk(self, name, &depth);
+  *exact = (depth == name->count);
+  return ret;
+}
+
 nametree_entry_t*
 ndn_nametree_prefix_match(
   ndn_nametree_t *self,
-  uint8_t name[],
-  size_t len,
+  const ndn_parsed_name_t* name,
   enum NDN_NAMETREE_ENTRY_TYPE entry_type)
 {
-  uint32_t type, varlen, complen;
-  uint8_t* ptr;
-  nametree_entry_t* par;
-  nametree_entry_t* cur;
-  nametree_entry_t* last = NULL;
-  int compare_ret;
+  nametree_entry_t* node;
+  ndn_table_id_t id;
+  bool exact;
 
-  ptr = tlv_get_type_length(name, len, &type, &varlen);
-  par = self->root;
-
-  if(entry_type == NDN_NAMETREE_FIB_TYPE && par->fib_id != NDN_INVALID_ID){
-    last = par;
-  }
-  if(entry_type == NDN_NAMETREE_PIT_TYPE && par->pit_id != NDN_INVALID_ID){
-    last = par;
+  node = ndn_nametree_longest_prefix(self, name, &exact);
+  for(id = ndn_nametree_getid(self, node); id != NDN_INVALID_ID; id = self->pool[id].parent){
+    if(entry_type == NDN_NAMETREE_FIB_TYPE && self->pool[id].fib_id != NDN_INVALID_ID){
+      return &self->pool[id];
+    }
+    if(entry_type == NDN_NAMETREE_PIT_TYPE && self->pool[id].pit_id != NDN_INVALID_ID){
+      return &self->pool[id];
+    }
   }
+  return NULL;
+}
 
-  while(ptr < name + len){
-    complen = tlv_get_type_length(ptr, name + len - ptr, &type, &varlen) - ptr;
-    complen += varlen;
-    compare_ret = nametree_splay(self, par, ptr, complen);
-    cur = par->sub;
-    if(cur == self->nil || compare_ret != 0){
-      return last;
-    }
-    par = cur;
-    ptr += complen;
+void
+ndn_nametree_prefetch(ndn_nametree_t *self, const ndn_parsed_name_t* name){
+  // Lookups splay the tree, so only the top of the first level is known ahead
+  NAMETREE_PREFETCH(name->name);
+  NAMETREE_PREFETCH(self->root->sub);
+}
+
+/** Search the levels below @c par.
+ *
+ * Each level is walked in order by Morris traversal, which threads the
+ * empty right links temporarily instead of keeping a stack.
+ * The threads are removed even after the search stops, so the walk finishes the level.
+ * The recursion is bounded by the number of components of a name.
+ */
+static nametree_entry_t*
+nametree_search_sub(ndn_nametree_t *self, nametree_entry_t* par,
+                    ndn_nametree_visit_t visit, void* ctx){
+  nametree_entry_t *cur = par->sub, *pre, *ret = NULL;
 
-    if(entry_type == NDN_NAMETREE_FIB_TYPE && par->fib_id != NDN_INVALID_ID){
-      last = par;
+  while(cur != self->nil){
+    if(cur->cop[LEFT] != self->nil){
+      for(pre = cur->cop[LEFT]; pre->cop[RIGHT] != self->nil && pre->cop[RIGHT] != cur;
+          pre = pre->cop[RIGHT]);
+      if(pre->cop[RIGHT] == self->nil){
+        pre->cop[RIGHT] = cur;
+        cur = cur->cop[LEFT];
+        continue;
+      }
+      pre->cop[RIGHT] = self->nil;
     }
-    if(entry_type == NDN_NAMETREE_PIT_TYPE && par->pit_id != NDN_INVALID_ID){
-      last = par;
+    if(ret == NULL){
+      ret = visit(ctx, cur) ? cur : nametree_search_sub(self, cur, visit, ctx);
     }
+    cur = cur->cop[RIGHT];
   }
-  return last;
+  return ret;
+}
+
+nametree_entry_t*
+ndn_nametree_search_subtree(ndn_nametree_t *self, nametree_entry_t* entry,
+                            ndn_nametree_visit_t visit, void* ctx){
+  return nametree_search_sub(self, entry, visit, ctx);
 }
 
 nametree_entry_t*
@@ -257,4 +358,4 @@ ndn_nametree_getid(ndn_nametree_t *self, nametree_entry_t* entry){
   return entry - self->pool;
 }
 
-// TODO: Delete, clean
+#endif // NDN_NAMETREE_SPLAY
@@ -10,14 +10,25 @@
 #define FORWARDER_NAME_SPLAY_H
 
 #include "../ndn-constants.h"
+#include "name-arena.h"
+#include "parsed-name.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
-// TODO: Rename; use compilation flags
-
 #ifdef __cplusplus
 extern "C" {
-#endif
+#endif // FORWARDER_NAME_SPLAY_H
+
+/** @defgroup NDNFwdNameSplay Splay Name Tree
+ * @brief Name Tree whose children of a node form a splay tree.
+ *
+ * Every lookup brings the components it visits to the top of their levels,
+ * so popular prefixes are found after few comparisons.
+ * Enabled by defining @c NDN_NAMETREE_SPLAY.
+ * @ingroup NDNFwd
+ * @{
+ */
 
 enum NDN_NAMETREE_ENTRY_TYPE{
   NDN_NAMETREE_FIB_TYPE,
@@ -29,42 +40,80 @@ enum NDN_NAMETREE_ENTRY_TYPE{
 
 typedef struct nametree_entry{
   uint8_t val[NDN_NAME_COMPONENT_BLOCK_SIZE];
+  ndn_table_id_t ext; /// Arena blocks holding the rest of a long component
   struct nametree_entry* sub; /// Subtree
   struct nametree_entry* cop[2]; /// Child or parent
+  ndn_table_id_t parent; /// The node of the parent prefix. #NDN_INVALID_ID for the root and free nodes
+  ndn_table_id_t ref_cnt; /// Number of children and table entries referring to this node
   ndn_table_id_t pit_id;
   ndn_table_id_t fib_id;
+  ndn_table_id_t cs_id;
+  ndn_table_id_t measurements_id;
 } nametree_entry_t;
 
 typedef struct ndn_nametree{
   nametree_entry_t *nil, *root;
+  ndn_name_arena_t arena; /// Storage of long components, following the pool
   nametree_entry_t pool[];
 }ndn_nametree_t;
 
 #define NDN_NAMETREE_RESERVE_SIZE(entry_count) \
-  (sizeof(nametree_entry_t) * (entry_count) + sizeof(ndn_nametree_t))
+  (sizeof(nametree_entry_t) * (entry_count) + sizeof(ndn_nametree_t) + \
+   NDN_NAME_ARENA_RESERVE_SIZE(entry_count))
 
 void
 ndn_nametree_init(void* memory, ndn_table_id_t capacity);
 
 nametree_entry_t*
-ndn_nametree_find_or_insert(ndn_nametree_t *self, uint8_t name[], size_t len);
+ndn_nametree_find_or_insert(ndn_nametree_t *self, const ndn_parsed_name_t* name);
+
+void
+ndn_nametree_ref(ndn_nametree_t *self, nametree_entry_t* entry);
+
+void
+ndn_nametree_unref(ndn_nametree_t *self, nametree_entry_t* entry);
+
+void
+ndn_nametree_release(ndn_nametree_t *self, nametree_entry_t* entry);
+
+nametree_entry_t*
+ndn_nametree_find(ndn_nametree_t *self, const ndn_parsed_name_t* name);
 
 nametree_entry_t*
-ndn_nametree_find(ndn_nametree_t *self, uint8_t name[], size_t len);
+ndn_nametree_longest_prefix(ndn_nametree_t *self, const ndn_parsed_name_t* name, bool* exact);
 
 nametree_entry_t*
 ndn_nametree_prefix_match(
   ndn_nametree_t *self,
-  uint8_t name[],
-  size_t len,
+  const ndn_parsed_name_t* name,
   enum NDN_NAMETREE_ENTRY_TYPE entry_type);
 
+void
+ndn_nametree_prefetch(ndn_nametree_t *self, const ndn_parsed_name_t* name);
+
+/** Called on each node by #ndn_nametree_search_subtree.
+ * @return Whether the search stops at this node.
+ */
+typedef bool (*ndn_nametree_visit_t)(void* ctx, nametree_entry_t* node);
+
+/** Search the nodes below @c entry, in no particular order.
+ *
+ * The cost grows with the size of the subtree, not of the whole NameTree.
+ * @c visit must not change the NameTree.
+ * @return The node @c visit stopped at. @c NULL if none.
+ */
+nametree_entry_t*
+ndn_nametree_search_subtree(ndn_nametree_t *self, nametree_entry_t* entry,
+                            ndn_nametree_visit_t visit, void* ctx);
+
 nametree_entry_t*
 ndn_nametree_at(ndn_nametree_t *self, ndn_table_id_t id);
 
 ndn_table_id_t
 ndn_nametree_getid(ndn_nametree_t *self, nametree_entry_t* entry);
 
+/*@}*/
+
 #ifdef __cplusplus
 }
 #endif
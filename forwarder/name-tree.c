@@ -6,189 +6,284 @@
  * directory for more details.
  */
 
+#if !defined(NDN_NAMETREE_HASH) && !defined(NDN_NAMETREE_SPLAY)
+
 #include "name-tree.h"
 #include <string.h>
+#include <stdint.h>
 
-#define minof2(a, b) ((a) < (b) ? (a) : (b))
+#if defined(__GNUC__)
+#define NAMETREE_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define NAMETREE_PREFETCH(addr) ((void)(addr))
+#endif
 
 static void
-nametree_refresh(ndn_nametree_t *nametree, int num)
+nametree_refresh(ndn_nametree_t *nametree, ndn_table_id_t num)
 {
-  (*nametree)[num].left_child = NDN_INVALID_ID;
-  (*nametree)[num].pit_id = NDN_INVALID_ID;
-  (*nametree)[num].fib_id = NDN_INVALID_ID;
+  ndn_name_arena_free(&nametree->arena, nametree->components[num].ext);
+  nametree->components[num].ext = NDN_INVALID_ID;
+  nametree->pool[num].left_child = NDN_INVALID_ID;
+  nametree->pool[num].parent = NDN_INVALID_ID;
+  nametree->pool[num].ref_cnt = 0;
+  nametree->pool[num].pit_id = NDN_INVALID_ID;
+  nametree->pool[num].fib_id = NDN_INVALID_ID;
+  nametree->pool[num].cs_id = NDN_INVALID_ID;
+  nametree->pool[num].measurements_id = NDN_INVALID_ID;
 
-  (*nametree)[num].right_bro = (*nametree)[0].right_bro;
-  (*nametree)[0].right_bro = num;
+  nametree->pool[num].right_bro = nametree->pool[0].right_bro;
+  nametree->pool[0].right_bro = num;
 }
 
-static int
-nametree_clean(ndn_nametree_t *nametree, int num)
+static void
+nametree_reclaim(ndn_nametree_t *nametree, ndn_table_id_t num)
 {
-  int ret = 0;
-  if (num == NDN_INVALID_ID) {
-    return NDN_INVALID_ID;
-  }
-  else {
-    (*nametree)[num].left_child = nametree_clean(nametree, (*nametree)[num].left_child);
-    (*nametree)[num].right_bro = nametree_clean(nametree, (*nametree)[num].right_bro);
-    if ((*nametree)[num].fib_id == NDN_INVALID_ID &&
-        (*nametree)[num].pit_id == NDN_INVALID_ID &&
-        (*nametree)[num].left_child == NDN_INVALID_ID) {
-      ret = (*nametree)[num].right_bro;
-      nametree_refresh(nametree, num);
-      return ret;
+  ndn_table_id_t father, prev;
+  // Free the node and its ancestors until one is still referenced
+  while (num != 0 && nametree->pool[num].ref_cnt == 0) {
+    father = nametree->pool[num].parent;
+    prev = nametree->pool[father].left_child;
+    if (prev == num) {
+      nametree->pool[father].left_child = nametree->pool[num].right_bro;
     }
     else {
-      return num;
+      while (nametree->pool[prev].right_bro != num) {
+        prev = nametree->pool[prev].right_bro;
+      }
+      nametree->pool[prev].right_bro = nametree->pool[num].right_bro;
     }
+    nametree_refresh(nametree, num);
+    nametree->pool[father].ref_cnt --;
+    num = father;
   }
 }
 
-static void
-nametree_cleanup(ndn_nametree_t *nametree)
-{
-  (*nametree)[0].left_child = nametree_clean(nametree, (*nametree)[0].left_child);
-}
-
 void
 ndn_nametree_init(void* memory, ndn_table_id_t capacity)
 {
   ndn_nametree_t *nametree = (ndn_nametree_t*)memory;
-  //all free entries are linked as right_bro of (*nametree)[0], the root of the tree.
-  for (int i = 0; i < capacity; ++i) {
-    (*nametree)[i].left_child = (*nametree)[i].pit_id = (*nametree)[i].fib_id = NDN_INVALID_ID;
-    (*nametree)[i].right_bro = i + 1;
+  uintptr_t pool = (uintptr_t)(nametree + 1);
+
+  // The memory is only aligned to a pointer, so the nodes take the first cache line boundary
+  pool = (pool + NDN_NAMETREE_CACHE_LINE - 1) & ~(uintptr_t)(NDN_NAMETREE_CACHE_LINE - 1);
+  nametree->pool = (nametree_entry_t*)pool;
+  nametree->components = (nametree_component_t*)&nametree->pool[capacity];
+  //all free entries are linked as right_bro of pool[0], the root of the tree.
+  for (ndn_table_id_t i = 0; i < capacity; ++i) {
+    nametree->pool[i].hash = NDN_NAME_HASH_SEED;
+    nametree->pool[i].left_child = nametree->pool[i].pit_id = nametree->pool[i].fib_id = NDN_INVALID_ID;
+    nametree->pool[i].cs_id = nametree->pool[i].parent = NDN_INVALID_ID;
+    nametree->pool[i].measurements_id = NDN_INVALID_ID;
+    nametree->pool[i].ref_cnt = 0;
+    nametree->pool[i].right_bro = i + 1;
+    nametree->components[i].ext = NDN_INVALID_ID;
   }
-  (*nametree)[capacity - 1].right_bro = NDN_INVALID_ID;
+  nametree->pool[capacity - 1].right_bro = NDN_INVALID_ID;
+  ndn_name_arena_init(&nametree->arena, &nametree->components[capacity], capacity);
 }
 
-static int
-nametree_create_node(ndn_nametree_t *nametree, uint8_t name[], size_t len)
+static ndn_table_id_t
+nametree_create_node(ndn_nametree_t *nametree, ndn_table_id_t father, uint8_t name[], size_t len,
+                     uint32_t hash)
 {
-  int output = (*nametree)[0].right_bro;
+  ndn_table_id_t output = nametree->pool[0].right_bro;
   if (output == NDN_INVALID_ID) return NDN_INVALID_ID;
-  (*nametree)[0].right_bro = (*nametree)[output].right_bro;
-  (*nametree)[output].left_child  = (*nametree)[output].right_bro = NDN_INVALID_ID;
-  (*nametree)[output].pit_id = (*nametree)[output].fib_id = NDN_INVALID_ID;
-  memcpy((*nametree)[output].val, name, len);
+  if (!ndn_name_arena_store(&nametree->arena, nametree->components[output].val,
+                            &nametree->components[output].ext, name, len)) {
+    return NDN_INVALID_ID;
+  }
+  nametree->pool[output].hash = hash;
+  nametree->pool[0].right_bro = nametree->pool[output].right_bro;
+  nametree->pool[output].left_child  = nametree->pool[output].right_bro = NDN_INVALID_ID;
+  nametree->pool[output].pit_id = nametree->pool[output].fib_id = NDN_INVALID_ID;
+  nametree->pool[output].cs_id = NDN_INVALID_ID;
+  nametree->pool[output].measurements_id = NDN_INVALID_ID;
+  nametree->pool[output].parent = father;
+  nametree->pool[output].ref_cnt = 0;
+  nametree->pool[father].ref_cnt ++;
   return output;
 }
 
-nametree_entry_t*
-ndn_nametree_find(ndn_nametree_t *nametree, uint8_t name[], size_t len)
+/** Find the child of @c father holding the @c i-th component of @c name.
+ *
+ * The component bytes are compared only if the fingerprints are equal.
+ * @param[out] last_node The child before the returned one in order.
+ * @param[out] cmp The comparison with the returned node. Nonzero if not found.
+ */
+static ndn_table_id_t
+nametree_find_child(ndn_nametree_t *nametree, ndn_table_id_t father, const ndn_parsed_name_t* name,
+                    uint16_t i, ndn_table_id_t* last_node, int* cmp)
 {
-  int now_node, last_node, father = 0 , offset = 0 , tmp;
-  size_t component_len, eqiv_component_len;
-  // TODO: Put it into decoder
-  if (len < 2) return NULL;
-  if (name[1] < 253) offset = 2; else offset = 4;
-  while (offset < len) {
-    component_len = name[offset + 1] + 2;
-    eqiv_component_len = minof2(component_len, NDN_NAME_COMPONENT_BUFFER_SIZE);
-    now_node = (*nametree)[father].left_child;
-    last_node = NDN_INVALID_ID;
-    tmp = -2;
-    while (now_node != NDN_INVALID_ID) {
-      tmp = memcmp(name+offset, (*nametree)[now_node].val , eqiv_component_len);
-      if (tmp <= 0) break;
-      last_node = now_node;
-      now_node = (*nametree)[now_node].right_bro;
+  ndn_table_id_t now_node = nametree->pool[father].left_child;
+  uint32_t hash = name->hashes[i + 1];
+  *last_node = NDN_INVALID_ID;
+  *cmp = -2;
+  while (now_node != NDN_INVALID_ID) {
+    if (nametree->pool[now_node].hash != hash) {
+      *cmp = (hash < nametree->pool[now_node].hash ? -1 : 1);
+    }
+    else {
+      *cmp = ndn_name_arena_compare(&nametree->arena, ndn_parsed_name_component(name, i),
+                                    ndn_parsed_name_component_size(name, i),
+                                    nametree->components[now_node].val,
+                                    nametree->components[now_node].ext);
     }
+    if (*cmp <= 0) break;
+    *last_node = now_node;
+    now_node = nametree->pool[now_node].right_bro;
+  }
+  return now_node;
+}
+
+nametree_entry_t*
+ndn_nametree_find(ndn_nametree_t *nametree, const ndn_parsed_name_t* name)
+{
+  ndn_table_id_t now_node, last_node, father = 0;
+  int tmp;
+  uint16_t i;
+  for (i = 0; i < name->count; i ++) {
+    now_node = nametree_find_child(nametree, father, name, i, &last_node, &tmp);
     if (tmp != 0) {
       return NULL;
     }
-    offset += component_len;
     father = now_node;
   }
-  return &(*nametree)[father];
+  return &nametree->pool[father];
 }
 
-static nametree_entry_t*
-nametree_find_or_insert_try(ndn_nametree_t *nametree, uint8_t name[], size_t len)
+nametree_entry_t*
+ndn_nametree_find_or_insert(ndn_nametree_t *nametree, const ndn_parsed_name_t* name)
 {
-  int now_node, last_node, father = 0 , offset = 0 , tmp , new_node_number;
-  size_t component_len, eqiv_component_len;
-  // TODO: Put it into decoder
-  if (len < 2) return NULL;
-  if (name[1] < 253) offset = 2; else offset = 4;
-  while (offset < len) {
-    component_len = name[offset + 1] + 2;
-    eqiv_component_len = minof2(component_len, NDN_NAME_COMPONENT_BUFFER_SIZE);
-    now_node = (*nametree)[father].left_child;
-    last_node = NDN_INVALID_ID;
-    tmp = -2;
-    while (now_node != NDN_INVALID_ID) {
-      tmp = memcmp(name+offset, (*nametree)[now_node].val , eqiv_component_len);
-      if (tmp <= 0) break;
-      last_node = now_node;
-      now_node = (*nametree)[now_node].right_bro;
-    }
+  ndn_table_id_t now_node, last_node, father = 0, new_node_number;
+  int tmp;
+  size_t component_len;
+  uint8_t *ptr;
+  uint16_t i;
+  for (i = 0; i < name->count; i ++) {
+    ptr = ndn_parsed_name_component(name, i);
+    component_len = ndn_parsed_name_component_size(name, i);
+    now_node = nametree_find_child(nametree, father, name, i, &last_node, &tmp);
     if (tmp != 0) {
-      new_node_number = nametree_create_node(nametree, name + offset , eqiv_component_len);
-      if (new_node_number == NDN_INVALID_ID) return NULL;
+      new_node_number = nametree_create_node(nametree, father, ptr, component_len,
+                                             name->hashes[i + 1]);
+      if (new_node_number == NDN_INVALID_ID) {
+        // Give back nodes created by this call
+        nametree_reclaim(nametree, father);
+        return NULL;
+      }
       if(last_node == NDN_INVALID_ID){
-        (*nametree)[father].left_child = new_node_number;
+        nametree->pool[father].left_child = new_node_number;
       }else{
-        (*nametree)[last_node].right_bro = new_node_number;
+        nametree->pool[last_node].right_bro = new_node_number;
       }
-      (*nametree)[new_node_number].right_bro = now_node;
+      nametree->pool[new_node_number].right_bro = now_node;
       now_node = new_node_number;
     }
-    offset += component_len;
     father = now_node;
   }
-  return &(*nametree)[father];
+  return &nametree->pool[father];
+}
+
+void
+ndn_nametree_ref(ndn_nametree_t *nametree, nametree_entry_t* entry)
+{
+  (void)nametree;
+  entry->ref_cnt ++;
+}
+
+void
+ndn_nametree_unref(ndn_nametree_t *nametree, nametree_entry_t* entry)
+{
+  entry->ref_cnt --;
+  nametree_reclaim(nametree, ndn_nametree_getid(nametree, entry));
+}
+
+void
+ndn_nametree_release(ndn_nametree_t *nametree, nametree_entry_t* entry)
+{
+  nametree_reclaim(nametree, ndn_nametree_getid(nametree, entry));
 }
 
 nametree_entry_t*
-ndn_nametree_find_or_insert(ndn_nametree_t *nametree, uint8_t name[], size_t len)
+ndn_nametree_longest_prefix(ndn_nametree_t *nametree, const ndn_parsed_name_t* name, bool* exact)
 {
-  nametree_entry_t* p = nametree_find_or_insert_try(nametree, name , len);
-  if (p == NULL) {
-    nametree_cleanup(nametree);
-    p = nametree_find_or_insert_try(nametree, name , len);
+  ndn_table_id_t now_node, prev_node, father = 0;
+  int tmp;
+  uint16_t i;
+  *exact = false;
+  for (i = 0; i < name->count; i ++) {
+    now_node = nametree_find_child(nametree, father, name, i, &prev_node, &tmp);
+    if (tmp != 0) return &nametree->pool[father];
+    father = now_node;
   }
-  return p;
+  *exact = true;
+  return &nametree->pool[father];
 }
 
 nametree_entry_t*
 ndn_nametree_prefix_match(
                           ndn_nametree_t* nametree,
-                          uint8_t name[],
-                          size_t len,
+                          const ndn_parsed_name_t* name,
                           enum NDN_NAMETREE_ENTRY_TYPE type)
 {
-  int now_node, last_node = NDN_INVALID_ID , father = 0 , offset = 0 , tmp;
-  size_t component_len, eqiv_component_len;
-  if (len < 2) return NULL;
-  if (name[1] < 253) offset = 2; else offset = 4;
-  while (offset < len) {
-    component_len = name[offset + 1] + 2;
-    eqiv_component_len = minof2(component_len, NDN_NAME_COMPONENT_BUFFER_SIZE);
-    now_node = (*nametree)[father].left_child;
-    tmp = -2;
-    while (now_node != NDN_INVALID_ID) {
-      tmp = memcmp(name+offset,(*nametree)[now_node].val , eqiv_component_len);
-      if (tmp <= 0) break;
-      now_node = (*nametree)[now_node].right_bro;
-    }
+  ndn_table_id_t now_node, last_node = NDN_INVALID_ID, prev_node, father = 0;
+  int tmp;
+  uint16_t i;
+  for (i = 0; i < name->count; i ++) {
+    now_node = nametree_find_child(nametree, father, name, i, &prev_node, &tmp);
     if (tmp == 0) {
-      if ((*nametree)[now_node].fib_id != NDN_INVALID_ID && type == NDN_NAMETREE_FIB_TYPE) last_node = now_node;
-      if ((*nametree)[now_node].pit_id != NDN_INVALID_ID && type == NDN_NAMETREE_PIT_TYPE) last_node = now_node;
+      if (nametree->pool[now_node].fib_id != NDN_INVALID_ID && type == NDN_NAMETREE_FIB_TYPE) last_node = now_node;
+      if (nametree->pool[now_node].pit_id != NDN_INVALID_ID && type == NDN_NAMETREE_PIT_TYPE) last_node = now_node;
     } else break;
-    offset += component_len;
     father = now_node;
   }
-  if (last_node == NDN_INVALID_ID) return NULL; else return &(*nametree)[last_node];
+  if (last_node == NDN_INVALID_ID) return NULL; else return &nametree->pool[last_node];
+}
+
+void
+ndn_nametree_prefetch(ndn_nametree_t *nametree, const ndn_parsed_name_t* name)
+{
+  // Each level depends on the previous one, so only the packet's name
+  // and the first child list can be fetched ahead of the walk.
+  // Walking the levels here by fingerprint would chase the same pointers as the lookup,
+  // which makes a batch about twice as slow.
+  NAMETREE_PREFETCH(name->name);
+  if (nametree->pool[0].left_child != NDN_INVALID_ID) {
+    NAMETREE_PREFETCH(&nametree->pool[nametree->pool[0].left_child]);
+  }
+}
+
+nametree_entry_t*
+ndn_nametree_search_subtree(ndn_nametree_t *nametree, nametree_entry_t* entry,
+                            ndn_nametree_visit_t visit, void* ctx)
+{
+  ndn_table_id_t top = ndn_nametree_getid(nametree, entry);
+  ndn_table_id_t now_node = entry->left_child;
+
+  // Depth-first by the child and brother links, climbing back by parent.
+  // The brother of top is never taken, since the root's one is the free list.
+  while (now_node != NDN_INVALID_ID) {
+    if (visit(ctx, &nametree->pool[now_node])) return &nametree->pool[now_node];
+    if (nametree->pool[now_node].left_child != NDN_INVALID_ID) {
+      now_node = nametree->pool[now_node].left_child;
+      continue;
+    }
+    while (now_node != top && nametree->pool[now_node].right_bro == NDN_INVALID_ID) {
+      now_node = nametree->pool[now_node].parent;
+    }
+    now_node = (now_node == top) ? NDN_INVALID_ID : nametree->pool[now_node].right_bro;
+  }
+  return NULL;
 }
 
 nametree_entry_t*
 ndn_nametree_at(ndn_nametree_t *self, ndn_table_id_t id){
-  return &(*self)[id];
+  return &self->pool[id];
 }
 
 ndn_table_id_t
 ndn_nametree_getid(ndn_nametree_t *self, nametree_entry_t* entry){
-  return entry - &(*self)[0];
+  return entry - self->pool;
 }
+
+#endif // NDN_NAMETREE_HASH, NDN_NAMETREE_SPLAY
@@ -9,7 +9,23 @@
 #ifndef FORWARDER_NAME_TREE_H
 #define FORWARDER_NAME_TREE_H
 
+// The backend is picked at compile time, the sibling lists below by default
+#if defined(NDN_NAMETREE_HASH) && defined(NDN_NAMETREE_SPLAY)
+#error "Define at most one of NDN_NAMETREE_HASH and NDN_NAMETREE_SPLAY"
+#elif defined(NDN_NAMETREE_HASH)
+// The hash table backend, see name-hash.h
+#include "name-hash.h"
+#elif defined(NDN_NAMETREE_SPLAY)
+// The splay tree backend, see name-splay.h
+#include "name-splay.h"
+#else
+
 #include "../ndn-constants.h"
+#include "name-arena.h"
+#include "parsed-name.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -26,14 +42,33 @@ enum NDN_NAMETREE_ENTRY_TYPE{
   NDN_NAMETREE_ENTRY_TYPE_CNT
 };
 
+/** The size of a cache line, to which NameTree nodes are aligned.
+ */
+#define NDN_NAMETREE_CACHE_LINE 64
+
+/** The size of a NameTree node, a divisor of #NDN_NAMETREE_CACHE_LINE.
+ *
+ * The 20 bytes of fields with 16-bit IDs fit in half a line.
+ * With @c NDN_FORWARDER_LARGE_TABLES they take 36 bytes, so a node takes a whole line.
+ */
+#ifdef NDN_FORWARDER_LARGE_TABLES
+#define NDN_NAMETREE_NODE_SIZE NDN_NAMETREE_CACHE_LINE
+#else
+#define NDN_NAMETREE_NODE_SIZE (NDN_NAMETREE_CACHE_LINE / 2)
+#endif
+
 /**
- * NameTree node.
+ * NameTree node, the part read while walking the tree.
+ *
+ * A node takes #NDN_NAMETREE_NODE_SIZE bytes, so none straddles two cache lines.
+ * The component lives in a parallel #nametree_component_t, read only when fingerprints match.
  */
 typedef struct nametree_entry{
   /**
-   * Name component of this node.
+   * Fingerprint of the node's name, the ndn_parsed_name#hashes of all its components.
+   * Siblings are sorted by it, then by their components.
    */
-  uint8_t val[NDN_NAME_COMPONENT_BLOCK_SIZE];
+  alignas(NDN_NAMETREE_NODE_SIZE) uint32_t hash;
 
   /**
    * First child of this node.
@@ -49,6 +84,18 @@ typedef struct nametree_entry{
    */
   ndn_table_id_t right_bro;
 
+  /**
+   * Parent of this node.
+   * #NDN_INVALID_ID for the root node and free nodes.
+   */
+  ndn_table_id_t parent;
+
+  /**
+   * Number of children and table entries referring to this node.
+   * The node is freed when it drops to 0.
+   */
+  ndn_table_id_t ref_cnt;
+
   /**
    * Corresponding PIT entry's id.
    * #NDN_INVALID_ID if none.
@@ -60,27 +107,127 @@ typedef struct nametree_entry{
    * #NDN_INVALID_ID if none.
    */
   ndn_table_id_t fib_id;
+
+  /**
+   * Corresponding CS entry's id.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t cs_id;
+
+  /**
+   * First Measurements entry of this prefix.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t measurements_id;
 } nametree_entry_t;
 
-typedef nametree_entry_t ndn_nametree_t[];
+static_assert(sizeof(nametree_entry_t) == NDN_NAMETREE_NODE_SIZE,
+               "a NameTree node must fill its share of a cache line exactly");
 
-#define NDN_NAMETREE_RESERVE_SIZE(entry_count) (sizeof(nametree_entry_t) * (entry_count))
+/**
+ * Name component of a NameTree node.
+ */
+typedef struct nametree_component{
+  /**
+   * Only the first #NDN_NAME_COMPONENT_BLOCK_SIZE bytes of a longer component.
+   */
+  uint8_t val[NDN_NAME_COMPONENT_BLOCK_SIZE];
+
+  /**
+   * Arena blocks holding the rest of a long component.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t ext;
+} nametree_component_t;
+
+typedef struct ndn_nametree{
+  /**
+   * Storage of long components, whose blocks follow @c components.
+   */
+  ndn_name_arena_t arena;
+
+  /**
+   * All nodes, aligned to a cache line. @c pool[0] is the root node "/".
+   */
+  nametree_entry_t* pool;
+
+  /**
+   * Components of the nodes, @c components[i] for @c pool[i].
+   */
+  nametree_component_t* components;
+}ndn_nametree_t;
+
+#define NDN_NAMETREE_RESERVE_SIZE(entry_count) \
+  (sizeof(ndn_nametree_t) + NDN_NAMETREE_CACHE_LINE - 1 + \
+   (sizeof(nametree_entry_t) + sizeof(nametree_component_t)) * (entry_count) + \
+   NDN_NAME_ARENA_RESERVE_SIZE(entry_count))
 
 void
 ndn_nametree_init(void* memory, ndn_table_id_t capacity);
 
+/** Find the node of a name, creating it if not exists.
+ *
+ * A new node is not referenced. The caller should either take it by
+ * #ndn_nametree_ref or give it back by #ndn_nametree_release.
+ * @return The node. @c NULL if NameTree is full.
+ */
 nametree_entry_t*
-ndn_nametree_find_or_insert(ndn_nametree_t* nametree, uint8_t name[], size_t len);
+ndn_nametree_find_or_insert(ndn_nametree_t* nametree, const ndn_parsed_name_t* name);
+
+/** Add a reference to a node from a table entry.
+ */
+void
+ndn_nametree_ref(ndn_nametree_t *nametree, nametree_entry_t* entry);
+
+/** Drop a reference to a node.
+ *
+ * The node and its ancestors are freed as soon as nothing refers to them.
+ */
+void
+ndn_nametree_unref(ndn_nametree_t *nametree, nametree_entry_t* entry);
+
+/** Free a node and its ancestors if nothing refers to them.
+ */
+void
+ndn_nametree_release(ndn_nametree_t *nametree, nametree_entry_t* entry);
+
+/** Find the longest prefix of @c name that has a node.
+ * @param[out] exact Set to whether the node returned is the node of @c name.
+ * @return The node of the longest prefix, the root if none.
+ */
+nametree_entry_t*
+ndn_nametree_longest_prefix(ndn_nametree_t *nametree, const ndn_parsed_name_t* name, bool* exact);
 
 nametree_entry_t*
 ndn_nametree_prefix_match(
   ndn_nametree_t* nametree,
-  uint8_t name[],
-  size_t len,
+  const ndn_parsed_name_t* name,
   enum NDN_NAMETREE_ENTRY_TYPE type);
 
 nametree_entry_t*
-ndn_nametree_find(ndn_nametree_t *nametree, uint8_t name[], size_t len);
+ndn_nametree_find(ndn_nametree_t *nametree, const ndn_parsed_name_t* name);
+
+/** Prefetch the memory a lookup of @c name will touch.
+ *
+ * Called for every packet of a batch before any of them is looked up.
+ */
+void
+ndn_nametree_prefetch(ndn_nametree_t *nametree, const ndn_parsed_name_t* name);
+
+/** Called on each node by #ndn_nametree_search_subtree.
+ * @return Whether the search stops at this node.
+ */
+typedef bool (*ndn_nametree_visit_t)(void* ctx, nametree_entry_t* node);
+
+/** Search the nodes below @c entry, in no particular order.
+ *
+ * The cost grows with the size of the subtree, not of the whole NameTree.
+ * @c visit must not change the NameTree.
+ * @return The node @c visit stopped at. @c NULL if none.
+ */
+nametree_entry_t*
+ndn_nametree_search_subtree(ndn_nametree_t *nametree, nametree_entry_t* entry,
+                            ndn_nametree_visit_t visit, void* ctx);
 
 nametree_entry_t*
 ndn_nametree_at(ndn_nametree_t *self, ndn_table_id_t id);
@@ -90,4 +237,6 @@ ndn_nametree_getid(ndn_nametree_t *self, nametree_entry_t* entry);
 
 /*@}*/
 
+#endif // NDN_NAMETREE_HASH, NDN_NAMETREE_SPLAY
+
 #endif // FORWARDER_NAME_TREE_H
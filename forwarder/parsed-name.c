@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "parsed-name.h"
+#include "../ndn-error-code.h"
+#include "../encode/tlv.h"
+#include "../encode/forwarder-helper.h"
+
+int
+ndn_parsed_name_init(ndn_parsed_name_t* self, uint8_t* name, size_t buflen)
+{
+  uint32_t type, varlen;
+  uint8_t *ptr, *end, *val;
+  size_t comp_len;
+
+  if(name == NULL)
+    return NDN_INVALID_POINTER;
+  ptr = tlv_get_type_length(name, buflen, &type, &varlen);
+  if(ptr == NULL || varlen > buflen - (ptr - name))
+    return NDN_OVERSIZE_VAR;
+  if(type != TLV_Name)
+    return NDN_WRONG_TLV_TYPE;
+  end = ptr + varlen;
+  if(end - name > UINT16_MAX)
+    return NDN_OVERSIZE;
+
+  self->name = name;
+  self->size = (uint16_t)(end - name);
+  self->count = 0;
+  self->hashes[0] = NDN_NAME_HASH_SEED;
+  while(ptr < end){
+    if(self->count >= NDN_FORWARDER_MAX_COMPONENTS)
+      return NDN_OVERSIZE;
+    // Multi-byte lengths are decoded in full, so a component may be larger than 252 bytes
+    val = tlv_get_type_length(ptr, end - ptr, &type, &varlen);
+    if(val == NULL || varlen > (size_t)(end - val))
+      return NDN_OVERSIZE_VAR;
+    comp_len = (val - ptr) + varlen;
+    self->offsets[self->count] = (uint16_t)(ptr - name);
+    self->hashes[self->count + 1] = ndn_name_hash(self->hashes[self->count], ptr, comp_len);
+    self->count ++;
+    ptr += comp_len;
+  }
+  self->offsets[self->count] = self->size;
+  return NDN_SUCCESS;
+}
+
+int
+ndn_parsed_packet_init(ndn_parsed_packet_t* self, uint8_t* packet, size_t length)
+{
+  uint32_t val_len;
+  uint8_t *buf, *name;
+  size_t name_len;
+  bool is_nack = false;
+  int ret;
+
+  if(packet == NULL)
+    return NDN_INVALID_POINTER;
+
+  buf = tlv_get_type_length(packet, length, &self->type, &val_len);
+  if(buf == NULL || val_len != length - (buf - packet))
+    return NDN_WRONG_TLV_LENGTH;
+
+  if(self->type == TLV_LpPacket){
+    ret = tlv_lp_get_fragment(packet, length, &is_nack, &self->reason, &packet, &length);
+    if(ret != NDN_SUCCESS)
+      return ret;
+    buf = tlv_get_type_length(packet, length, &self->type, &val_len);
+    if(buf == NULL || val_len != length - (buf - packet))
+      return NDN_WRONG_TLV_LENGTH;
+  }
+  self->packet = packet;
+  self->length = length;
+
+  if(self->type == TLV_Interest){
+    ret = tlv_interest_get_header(packet, length, &self->options, &name, &name_len);
+    if(is_nack)
+      self->type = TLV_LpNack;
+  }
+  else if(self->type == TLV_Data && !is_nack)
+    ret = tlv_data_get_name(packet, length, &name, &name_len);
+  else
+    return NDN_WRONG_TLV_TYPE;
+  if(ret != NDN_SUCCESS)
+    return ret;
+  return ndn_parsed_name_init(&self->name, name, length - (name - packet));
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef FORWARDER_PARSED_NAME_H
+#define FORWARDER_PARSED_NAME_H
+
+#include "../ndn-constants.h"
+#include "../encode/forwarder-helper.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup NDNFwdParsedName Parsed Name
+ * @brief A Name tokenized and hashed once per packet.
+ *
+ * The forwarder parses the Name of a packet when it reads the header,
+ * and all table lookups of the packet use the component offsets and prefix hashes
+ * kept here instead of decoding the Name again.
+ * A packet parsed by a face thread or a forwarder pool is handed over as an
+ * ndn_parsed_packet, so its header is not parsed again by the forwarder.
+ * @ingroup NDNFwd
+ * @{
+ */
+
+/** The hash of the empty prefix.
+ */
+#define NDN_NAME_HASH_SEED 2166136261u
+
+/** The multiplier of FNV-1a.
+ */
+#define NDN_NAME_HASH_PRIME 16777619u
+
+/**
+ * Parsed Name.
+ */
+typedef struct ndn_parsed_name {
+  /** The encoded Name, pointing into the packet.
+   */
+  uint8_t* name;
+
+  /** The size of the whole Name TLV.
+   */
+  uint16_t size;
+
+  /** Number of components.
+   */
+  uint16_t count;
+
+  /** Offsets of components from @c name. @c offsets[count] is @c size.
+   */
+  uint16_t offsets[NDN_FORWARDER_MAX_COMPONENTS + 1];
+
+  /** FNV-1a of the encoding of the first @c i components.
+   * @c hashes[0] is #NDN_NAME_HASH_SEED, and @c hashes[count] is the hash of the Name's value.
+   */
+  uint32_t hashes[NDN_FORWARDER_MAX_COMPONENTS + 1];
+} ndn_parsed_name_t;
+
+/** Continue the FNV-1a hash of a prefix with more bytes.
+ */
+static inline uint32_t
+ndn_name_hash(uint32_t seed, const uint8_t* buf, size_t len)
+{
+  while(len --){
+    seed = (seed ^ *(buf ++)) * NDN_NAME_HASH_PRIME;
+  }
+  return seed;
+}
+
+/** Parse a Name.
+ *
+ * @param[out] self The parsed Name.
+ * @param[in] name The encoded Name.
+ * @param[in] buflen The size of the buffer holding @c name, which may go past the Name.
+ * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
+ * @retval #NDN_WRONG_TLV_TYPE @c name is not a Name.
+ * @retval #NDN_OVERSIZE_VAR A TLV length goes beyond @c buflen.
+ * @retval #NDN_OVERSIZE @c name is larger than 64KB or has more than
+ *                       #NDN_FORWARDER_MAX_COMPONENTS components.
+ */
+int
+ndn_parsed_name_init(ndn_parsed_name_t* self, uint8_t* name, size_t buflen);
+
+/** Get the @c i-th component, including its type and length.
+ */
+static inline uint8_t*
+ndn_parsed_name_component(const ndn_parsed_name_t* self, uint16_t i)
+{
+  return self->name + self->offsets[i];
+}
+
+/** Get the size of the @c i-th component, including its type and length.
+ */
+static inline size_t
+ndn_parsed_name_component_size(const ndn_parsed_name_t* self, uint16_t i)
+{
+  return self->offsets[i + 1] - self->offsets[i];
+}
+
+/**
+ * A received packet with its header parsed.
+ */
+typedef struct ndn_parsed_packet {
+  /** The Interest or Data, unwrapped from its NDNLPv2 packet if any.
+   */
+  uint8_t* packet;
+
+  /** The length of @c packet.
+   */
+  size_t length;
+
+  /** #TLV_Interest, #TLV_Data, or #TLV_LpNack for a Nack of an Interest.
+   */
+  uint32_t type;
+
+  /** The Nack reason if @c type is #TLV_LpNack.
+   */
+  uint32_t reason;
+
+  /** The options if @c type is #TLV_Interest or #TLV_LpNack.
+   */
+  interest_options_t options;
+
+  /** The Name, tokenized and hashed for all table lookups of the packet.
+   */
+  ndn_parsed_name_t name;
+} ndn_parsed_packet_t;
+
+/** Parse the header of a received packet.
+ *
+ * An NDNLPv2 packet is unwrapped. @c self points into @c packet afterwards.
+ * @param[out] self The parsed packet.
+ * @param[in] packet The encoded packet.
+ * @param[in] length The length of @c packet.
+ * @return #NDN_SUCCESS if the call succeeded. The error code otherwise.
+ * @retval #NDN_WRONG_TLV_LENGTH The length of a TLV does not match @c length.
+ * @retval #NDN_WRONG_TLV_TYPE @c packet is not an Interest, Data or Nack.
+ */
+int
+ndn_parsed_packet_init(ndn_parsed_packet_t* self, uint8_t* packet, size_t length);
+
+/** Point a parsed packet into a copy of the buffer it was parsed from.
+ *
+ * @param[in, out] self The parsed packet, pointing into @c from.
+ * @param[in] from The buffer @c self was parsed from.
+ * @param[in] to The copy of @c from.
+ */
+static inline void
+ndn_parsed_packet_rebase(ndn_parsed_packet_t* self, const uint8_t* from, uint8_t* to)
+{
+  self->packet = to + (self->packet - from);
+  self->name.name = to + (self->name.name - from);
+}
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FORWARDER_PARSED_NAME_H
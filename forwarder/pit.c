@@ -7,137 +7,315 @@
  */
 
 #include "pit.h"
-#include "../util/msg-queue.h"
+#include "strategy.h"
 
 static inline void
 ndn_pit_entry_reset(ndn_pit_entry_t* self){
   self->nametree_id = NDN_INVALID_ID;
   self->last_time = 0;
   self->express_time = 0;
-  self->incoming_faces = 0;
-  self->outgoing_faces = 0;
+  self->send_time = 0;
+  self->retx_interval = 0;
+  self->strategy = NULL;
+  self->route_id = NDN_INVALID_ID;
+  self->match_next = NDN_INVALID_ID;
+  faceset_clear(&self->incoming_faces);
+  faceset_clear(&self->outgoing_faces);
+  faceset_clear(&self->nacked_faces);
+  self->nack_reason = NDN_NACK_REASON_NONE;
+  self->face_epoch = 0;
   self->on_data = NULL;
   self->on_timeout = NULL;
+  self->on_nack = NULL;
   self->userdata = NULL;
   // Don't reset options.nonce here
 }
 
-static void ndn_pit_timeout(void *selfptr, size_t param_len, void *param){
-  ndn_pit_t* self = (ndn_pit_t*)selfptr;
-  ndn_table_id_t i;
-  ndn_time_ms_t now = ndn_time_now_ms();
+// Drop the faces unregistered since the entry was last looked up
+static inline ndn_pit_entry_t*
+ndn_pit_entry_refresh(ndn_pit_t* self, ndn_pit_entry_t* entry){
+  if(self->facetab != NULL && entry->face_epoch != self->facetab->epoch){
+    ndn_facetab_drop_stale(self->facetab, &entry->incoming_faces, entry->face_epoch);
+    ndn_facetab_drop_stale(self->facetab, &entry->outgoing_faces, entry->face_epoch);
+    ndn_facetab_drop_stale(self->facetab, &entry->nacked_faces, entry->face_epoch);
+    entry->face_epoch = self->facetab->epoch;
+  }
+  return entry;
+}
 
-  for(i = 0; i < self->capacity; i ++){
-    if(self->slots[i].nametree_id == NDN_INVALID_ID){
-      continue;
+#define PIT_HEAP(self) ((ndn_table_id_t*)&(self)->slots[(self)->capacity])
+
+static inline bool
+ndn_pit_heap_less(ndn_pit_t* self, ndn_table_id_t a, ndn_table_id_t b){
+  if(self->slots[a].expire_time != self->slots[b].expire_time){
+    return self->slots[a].expire_time < self->slots[b].expire_time;
+  }
+  return a < b;
+}
+
+static inline void
+ndn_pit_heap_place(ndn_pit_t* self, ndn_table_id_t pos, ndn_table_id_t id){
+  PIT_HEAP(self)[pos] = id;
+  self->slots[id].heap_index = pos;
+}
+
+static void
+ndn_pit_heap_sift_up(ndn_pit_t* self, ndn_table_id_t pos){
+  ndn_table_id_t* heap = PIT_HEAP(self);
+  ndn_table_id_t id = heap[pos];
+  ndn_table_id_t parent;
+  while(pos > 0){
+    parent = (pos - 1) / 2;
+    if(!ndn_pit_heap_less(self, id, heap[parent])){
+      break;
     }
+    ndn_pit_heap_place(self, pos, heap[parent]);
+    pos = parent;
+  }
+  ndn_pit_heap_place(self, pos, id);
+}
 
-    // User timeout
-    if(self->slots[i].on_data != NULL){
-      if(now - self->slots[i].express_time > self->slots[i].options.lifetime){
-        if(self->slots[i].on_timeout){
-          self->slots[i].on_timeout(self->slots[i].userdata);
-        }
-        self->slots[i].on_timeout = NULL;
-        self->slots[i].on_data = NULL;
-        self->slots[i].userdata = NULL;
-        self->slots[i].express_time = 0;
+static void
+ndn_pit_heap_sift_down(ndn_pit_t* self, ndn_table_id_t pos){
+  ndn_table_id_t* heap = PIT_HEAP(self);
+  ndn_table_id_t id = heap[pos];
+  size_t child;
+  while((child = (size_t)pos * 2 + 1) < self->heap_size){
+    if(child + 1 < self->heap_size && ndn_pit_heap_less(self, heap[child + 1], heap[child])){
+      child ++;
+    }
+    if(!ndn_pit_heap_less(self, heap[child], id)){
+      break;
+    }
+    ndn_pit_heap_place(self, pos, heap[child]);
+    pos = child;
+  }
+  ndn_pit_heap_place(self, pos, id);
+}
+
+static void
+ndn_pit_heap_remove(ndn_pit_t* self, ndn_pit_entry_t* entry){
+  ndn_table_id_t pos = entry->heap_index;
+  ndn_table_id_t last;
+  if(pos == NDN_INVALID_ID){
+    return;
+  }
+  entry->heap_index = NDN_INVALID_ID;
+  self->heap_size --;
+  if(pos == self->heap_size){
+    return;
+  }
+  last = PIT_HEAP(self)[self->heap_size];
+  ndn_pit_heap_place(self, pos, last);
+  ndn_pit_heap_sift_up(self, pos);
+  ndn_pit_heap_sift_down(self, self->slots[last].heap_index);
+}
+
+void
+ndn_pit_update_timer(ndn_pit_t* self, ndn_pit_entry_t* entry){
+  ndn_time_ms_t expire_time;
+  ndn_table_id_t id = entry - self->slots;
+
+  if(entry->nametree_id == NDN_INVALID_ID){
+    return;
+  }
+  // The earlier one of the user timeout and the PIT timeout
+  expire_time = entry->last_time;
+  if(entry->on_data != NULL && entry->express_time < expire_time){
+    expire_time = entry->express_time;
+  }
+  entry->expire_time = expire_time + entry->options.lifetime;
+
+  if(entry->heap_index == NDN_INVALID_ID){
+    ndn_pit_heap_place(self, self->heap_size, id);
+    self->heap_size ++;
+  }
+  ndn_pit_heap_sift_up(self, entry->heap_index);
+  ndn_pit_heap_sift_down(self, entry->heap_index);
+}
+
+static void
+ndn_pit_check_timeout(ndn_pit_t* self, ndn_pit_entry_t* entry, ndn_time_ms_t now){
+  if(entry->nametree_id == NDN_INVALID_ID){
+    return;
+  }
+  ndn_pit_entry_refresh(self, entry);
+
+  // User timeout
+  if(entry->on_data != NULL){
+    if(now - entry->express_time > entry->options.lifetime){
+      if(entry->on_timeout){
+        entry->on_timeout(entry->userdata);
       }
+      entry->on_timeout = NULL;
+      entry->on_data = NULL;
+      entry->on_nack = NULL;
+      entry->userdata = NULL;
+      entry->express_time = 0;
     }
-    // PIT timeout
-    if(now - self->slots[i].last_time > self->slots[i].options.lifetime){
-      ndn_pit_remove_entry(self, &self->slots[i]);
+  }
+  // PIT timeout
+  if(now - entry->last_time > entry->options.lifetime){
+    if(self->measurements != NULL){
+      ndn_measurements_on_timeout(self->measurements, entry->route_id, &entry->outgoing_faces);
     }
+    if(entry->strategy != NULL && entry->strategy->on_timeout != NULL && self->measures != NULL){
+      entry->strategy->on_timeout(self->measures, self->measurements, entry, now);
+    }
+    ndn_pit_remove_entry(self, entry);
+  }else{
+    ndn_pit_update_timer(self, entry);
   }
+}
+
+static void ndn_pit_timeout(void *selfptr, size_t param_len, void *param){
+  ndn_pit_t* self = (ndn_pit_t*)selfptr;
+  ndn_table_id_t id, next, *link;
+  ndn_table_id_t expired = NDN_INVALID_ID;
+  ndn_time_ms_t now = ndn_time_now_ms();
 
-  ndn_msgqueue_post(self, ndn_pit_timeout, 0, NULL);
+  // Take out expired entries, sorted by their slots so callbacks are called in the table order
+  while(self->heap_size > 0 && self->slots[PIT_HEAP(self)[0]].expire_time < now){
+    id = PIT_HEAP(self)[0];
+    ndn_pit_heap_remove(self, &self->slots[id]);
+    link = &expired;
+    while(*link != NDN_INVALID_ID && *link < id){
+      link = &self->slots[*link].expired_next;
+    }
+    self->slots[id].expired_next = *link;
+    *link = id;
+  }
+
+  for(id = expired; id != NDN_INVALID_ID; id = next){
+    next = self->slots[id].expired_next;
+    ndn_pit_check_timeout(self, &self->slots[id], now);
+  }
+
+  ndn_msgq_post(self->msgqueue, self, ndn_pit_timeout, 0, NULL);
 }
 
 void
-ndn_pit_init(void* memory, ndn_table_id_t capacity, ndn_nametree_t* nametree){
+ndn_pit_init(void* memory, ndn_table_id_t capacity, ndn_nametree_t* nametree,
+             ndn_msgqueue_t* msgqueue){
   ndn_table_id_t i;
   ndn_pit_t* self = (ndn_pit_t*)memory;
   self->capacity = capacity;
   self->nametree = nametree;
+  self->msgqueue = msgqueue;
+  self->measures = NULL;
+  self->facetab = NULL;
+  self->measurements = NULL;
+  self->heap_size = 0;
   for(i = 0; i < capacity; i ++){
     ndn_pit_entry_reset(&self->slots[i]);
     self->slots[i].options.nonce = 0;
+    self->slots[i].heap_index = NDN_INVALID_ID;
+    self->slots[i].next_free = i + 1;
+  }
+  if(capacity > 0){
+    self->slots[capacity - 1].next_free = NDN_INVALID_ID;
+    self->free_head = 0;
+  }else{
+    self->free_head = NDN_INVALID_ID;
   }
 
-  ndn_msgqueue_post(self, ndn_pit_timeout, 0, NULL);
+  ndn_msgq_post(self->msgqueue, self, ndn_pit_timeout, 0, NULL);
 }
 
 void
 ndn_pit_remove_entry(ndn_pit_t* self, ndn_pit_entry_t* entry){
-  ndn_nametree_at(self->nametree, entry->nametree_id)->pit_id = NDN_INVALID_ID;
-  ndn_pit_entry_reset(entry);
-}
-
-static inline void
-ndn_pit_remove_entry_if_empty(ndn_pit_t* self, ndn_pit_entry_t* entry){
   if(entry->nametree_id == NDN_INVALID_ID){
     return;
   }
-  if(entry->incoming_faces == 0 &&
-     entry->on_data == NULL &&
-     entry->on_timeout == NULL)
-  {
-    ndn_pit_remove_entry(self, entry);
-  }
-}
-
-void
-ndn_pit_unregister_face(ndn_pit_t* self, ndn_table_id_t face_id){
-  for (ndn_table_id_t i = 0; i < self->capacity; ++i){
-    self->slots[i].incoming_faces = bitset_unset(self->slots[i].incoming_faces, face_id);
-    ndn_pit_remove_entry_if_empty(self, &self->slots[i]);
+  ndn_pit_entry_refresh(self, entry);
+  if(entry->route_id != NDN_INVALID_ID){
+    if(self->measurements != NULL){
+      ndn_measurements_on_finish(self->measurements, entry->route_id, &entry->outgoing_faces);
+    }
+    ndn_nametree_unref(self->nametree, ndn_nametree_at(self->nametree, entry->route_id));
   }
+  nametree_entry_t* node = ndn_nametree_at(self->nametree, entry->nametree_id);
+  node->pit_id = NDN_INVALID_ID;
+  ndn_nametree_unref(self->nametree, node);
+  ndn_pit_heap_remove(self, entry);
+  ndn_pit_entry_reset(entry);
+  entry->next_free = self->free_head;
+  self->free_head = entry - self->slots;
 }
 
 static ndn_table_id_t
 ndn_pit_add_new_entry(ndn_pit_t* pit , int nametree_id){
-  ndn_table_id_t i;
-  for (i = 0; i < pit->capacity; ++i) {
-    if (pit->slots[i].nametree_id == NDN_INVALID_ID) {
-      ndn_pit_entry_reset(&pit->slots[i]);
-      pit->slots[i].nametree_id = nametree_id;
-      return i;
-    }
+  ndn_table_id_t i = pit->free_head;
+  if (i == NDN_INVALID_ID) {
+    return NDN_INVALID_ID;
   }
-  return NDN_INVALID_ID;
+  pit->free_head = pit->slots[i].next_free;
+  ndn_pit_entry_reset(&pit->slots[i]);
+  pit->slots[i].nametree_id = nametree_id;
+  pit->slots[i].face_epoch = (pit->facetab != NULL ? pit->facetab->epoch : 0);
+  pit->slots[i].next_free = NDN_INVALID_ID;
+  ndn_pit_update_timer(pit, &pit->slots[i]);
+  return i;
 }
 
 ndn_pit_entry_t*
-ndn_pit_find_or_insert(ndn_pit_t* self, uint8_t* name, size_t length){
-  nametree_entry_t* entry = ndn_nametree_find_or_insert(self->nametree, name, length);
+ndn_pit_find_or_insert(ndn_pit_t* self, const ndn_parsed_name_t* name){
+  nametree_entry_t* entry = ndn_nametree_find_or_insert(self->nametree, name);
   if(entry == NULL){
     return NULL;
   }
   if(entry->pit_id == NDN_INVALID_ID){
     entry->pit_id = ndn_pit_add_new_entry(self, ndn_nametree_getid(self->nametree, entry));
     if(entry->pit_id == NDN_INVALID_ID){
+      ndn_nametree_release(self->nametree, entry);
       return NULL;
     }
+    ndn_nametree_ref(self->nametree, entry);
   }
-  return &self->slots[entry->pit_id];
+  return ndn_pit_entry_refresh(self, &self->slots[entry->pit_id]);
 }
 
 ndn_pit_entry_t*
-ndn_pit_find(ndn_pit_t* self, uint8_t* prefix, size_t length)
+ndn_pit_find(ndn_pit_t* self, const ndn_parsed_name_t* name)
 {
-  nametree_entry_t* entry = ndn_nametree_find(self->nametree, prefix, length);
+  nametree_entry_t* entry = ndn_nametree_find(self->nametree, name);
   if (entry == NULL || entry->pit_id == NDN_INVALID_ID) {
     return NULL;
   }
-  return &self->slots[entry->pit_id];
+  return ndn_pit_entry_refresh(self, &self->slots[entry->pit_id]);
 }
 
 ndn_pit_entry_t*
-ndn_pit_prefix_match(ndn_pit_t* self, uint8_t* prefix, size_t length)
+ndn_pit_prefix_match(ndn_pit_t* self, const ndn_parsed_name_t* name)
 {
-  nametree_entry_t* entry = ndn_nametree_prefix_match(self->nametree, prefix, length, NDN_NAMETREE_PIT_TYPE);
+  nametree_entry_t* entry = ndn_nametree_prefix_match(self->nametree, name, NDN_NAMETREE_PIT_TYPE);
   if (entry == NULL || entry->pit_id == NDN_INVALID_ID) {
     return NULL;
   }
-  return &self->slots[entry->pit_id];
+  return ndn_pit_entry_refresh(self, &self->slots[entry->pit_id]);
+}
+
+ndn_pit_entry_t*
+ndn_pit_match_data(ndn_pit_t* self, const ndn_parsed_name_t* name)
+{
+  nametree_entry_t* node;
+  ndn_table_id_t id, head = NDN_INVALID_ID, *link = &head;
+  bool exact;
+
+  node = ndn_nametree_longest_prefix(self->nametree, name, &exact);
+  // Ancestors of the deepest node are the shorter prefixes, and only their CanBePrefix entries match
+  for (id = ndn_nametree_getid(self->nametree, node); id != NDN_INVALID_ID;
+       id = ndn_nametree_at(self->nametree, id)->parent, exact = false) {
+    node = ndn_nametree_at(self->nametree, id);
+    if (node->pit_id == NDN_INVALID_ID) {
+      continue;
+    }
+    if (exact || self->slots[node->pit_id].options.can_be_prefix) {
+      ndn_pit_entry_refresh(self, &self->slots[node->pit_id]);
+      *link = node->pit_id;
+      link = &self->slots[node->pit_id].match_next;
+    }
+  }
+  *link = NDN_INVALID_ID;
+  return (head == NDN_INVALID_ID) ? NULL : &self->slots[head];
 }
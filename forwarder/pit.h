@@ -11,14 +11,19 @@
 #include "../encode/forwarder-helper.h"
 #include "../util/bit-operations.h"
 #include "face.h"
+#include "face-table.h"
+#include "measurements.h"
 #include "name-tree.h"
 #include "callback-funcs.h"
 #include "../util/uniform-time.h"
+#include "../util/msg-queue.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct ndn_strategy;
+
 /** @defgroup NDNFwdPIT PIT
  * @brief Pending Interest Table
  * @ingroup NDNFwd
@@ -36,12 +41,24 @@ typedef struct ndn_pit_entry {
   /** Faces received this Interest.
    * Used to forward corresponding Data.
    */
-  uint64_t incoming_faces;
+  ndn_faceset_t incoming_faces;
 
   /** Faces sent out this Interest.
    * Used to suppress Interest forwarding.
    */
-  uint64_t outgoing_faces;
+  ndn_faceset_t outgoing_faces;
+
+  /** Faces which returned a Nack for this Interest, a subset of @c outgoing_faces.
+   */
+  ndn_faceset_t nacked_faces;
+
+  /** The least severe reason of Nacks received, given to downstream if all faces Nack.
+   */
+  uint32_t nack_reason;
+
+  /** The ndn_face_table#epoch when the face sets were last cleaned of unregistered faces.
+   */
+  uint32_t face_epoch;
 
   /** Timestamp for last time the forwarder received this Interest.
    */
@@ -52,6 +69,28 @@ typedef struct ndn_pit_entry {
    */
   ndn_time_ms_t express_time;
 
+  /** Timestamp for last time the forwarder sent out this Interest.
+   * 0 if never sent.
+   */
+  ndn_time_ms_t send_time;
+
+  /** Interests arriving within this many milliseconds after ndn_pit_entry#send_time
+   * are aggregated without being sent again. Later ones are retransmitted,
+   * to a tried next hop if no other is left. Doubles on each retransmission.
+   */
+  uint32_t retx_interval;
+
+  /** The strategy which sent out this Interest.
+   * Notified when Data comes back or the entry times out.
+   */
+  const struct ndn_strategy* strategy;
+
+  /** NameTree entry's ID of the FIB prefix this Interest was sent under.
+   * Keys the Measurements entries. #NDN_INVALID_ID if never sent.
+   * The NameTree entry is referenced, so it stays valid after the FIB entry is removed.
+   */
+  ndn_table_id_t route_id;
+
   /** OnData callback if the application expressed this Interest.
    */
   ndn_on_data_func on_data;
@@ -60,46 +99,125 @@ typedef struct ndn_pit_entry {
    */
   ndn_on_timeout_func on_timeout;
 
+  /** OnNack callback if the application expressed this Interest.
+   */
+  ndn_on_nack_func on_nack;
+
   /** User defined data.
    */
   void* userdata;
 
+  /** Timestamp when the next timeout of this entry occurs.
+   * The key of the timer heap.
+   */
+  ndn_time_ms_t expire_time;
+
   /** NameTree entry's ID.
    * #NDN_INVALID_ID if the entry is empty.
    */
   ndn_table_id_t nametree_id;
+
+  /** Position in the timer heap.
+   * #NDN_INVALID_ID if not scheduled.
+   */
+  ndn_table_id_t heap_index;
+
+  /** The next expired entry, only used during a timeout check.
+   */
+  ndn_table_id_t expired_next;
+
+  /** The next entry satisfied by the same Data, only used by ndn_pit_match_data().
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t match_next;
+
+  /** The next free entry if this entry is empty.
+   * #NDN_INVALID_ID if none.
+   */
+  ndn_table_id_t next_free;
 } ndn_pit_entry_t;
 
 /**
-* Forwarding Information Base (FIB).
+* Pending Interest Table (PIT).
 */
 typedef struct ndn_pit{
   ndn_nametree_t* nametree;
+
+  /** The message queue running the timeout check.
+   */
+  ndn_msgqueue_t* msgqueue;
+
+  /** Measurements of faces, passed to strategies when entries time out.
+   * Set by the forwarder. @c NULL if strategies are not notified.
+   */
+  ndn_face_measure_t* measures;
+
+  /** FaceTable whose unregistered faces are dropped from entries on lookup and timeout.
+   * Set by the forwarder. @c NULL if faces are never unregistered.
+   */
+  const ndn_face_table_t* facetab;
+
+  /** Measurements Table updated when entries are satisfied or time out.
+   * Set by the forwarder. @c NULL if not kept.
+   */
+  ndn_measurements_t* measurements;
+
   ndn_table_id_t capacity;
+
+  /** The first free entry.
+   * All free entries are linked by ndn_pit_entry#next_free.
+   */
+  ndn_table_id_t free_head;
+
+  /** The number of entries in the timer heap.
+   * The heap is a min-heap of entry IDs ordered by ndn_pit_entry#expire_time,
+   * stored right after @c slots.
+   */
+  ndn_table_id_t heap_size;
+
   ndn_pit_entry_t slots[];
 }ndn_pit_t;
 
 #define NDN_PIT_RESERVE_SIZE(entry_count) \
-  (sizeof(ndn_pit_t) + sizeof(ndn_pit_entry_t) * (entry_count))
+  (sizeof(ndn_pit_t) + (sizeof(ndn_pit_entry_t) + sizeof(ndn_table_id_t)) * (entry_count))
 
 void
-ndn_pit_init(void* memory, ndn_table_id_t capacity, ndn_nametree_t* nametree);
+ndn_pit_init(void* memory, ndn_table_id_t capacity, ndn_nametree_t* nametree,
+             ndn_msgqueue_t* msgqueue);
 
-void
-ndn_pit_unregister_face(ndn_pit_t* self, ndn_table_id_t face_id);
+ndn_pit_entry_t*
+ndn_pit_find_or_insert(ndn_pit_t* self, const ndn_parsed_name_t* name);
 
 ndn_pit_entry_t*
-ndn_pit_find_or_insert(ndn_pit_t* self, uint8_t* name, size_t length);
+ndn_pit_find(ndn_pit_t* self, const ndn_parsed_name_t* name);
 
 ndn_pit_entry_t*
-ndn_pit_find(ndn_pit_t* self, uint8_t* prefix, size_t length);
+ndn_pit_prefix_match(ndn_pit_t* self, const ndn_parsed_name_t* name);
 
+/** Find all entries a Data packet satisfies in one walk.
+ *
+ * These are the entry of the Data name, and the CanBePrefix entries of its prefixes.
+ * @param[in, out] self PIT.
+ * @param[in] name The Data name.
+ * @return The entry with the longest name, others linked by ndn_pit_entry#match_next
+ *         in descending name length. @c NULL if none.
+ */
 ndn_pit_entry_t*
-ndn_pit_prefix_match(ndn_pit_t* self, uint8_t* prefix, size_t length);
+ndn_pit_match_data(ndn_pit_t* self, const ndn_parsed_name_t* name);
 
 void
 ndn_pit_remove_entry(ndn_pit_t* self, ndn_pit_entry_t* entry);
 
+/** Reschedule the timeout of an entry.
+ *
+ * Must be called after ndn_pit_entry#last_time, ndn_pit_entry#express_time,
+ * ndn_pit_entry#on_data or the lifetime in ndn_pit_entry#options changes.
+ * @param[in, out] self PIT.
+ * @param[in, out] entry The entry changed.
+ */
+void
+ndn_pit_update_timer(ndn_pit_t* self, ndn_pit_entry_t* entry);
+
 /*@}*/
 
 #ifdef __cplusplus
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "strategy.h"
+
+/** Upper bound of a doubled timeout, in milliseconds.
+ */
+#define STRATEGY_MAX_RTO 60000
+
+static inline uint32_t
+strategy_rto(uint32_t srtt, uint32_t rttvar){
+  return srtt + 4 * rttvar;
+}
+
+void
+ndn_strategy_measure_rtt(ndn_face_measure_t* measures,
+                         ndn_measurements_t* measurements,
+                         ndn_pit_entry_t* entry,
+                         ndn_table_id_t face_id,
+                         ndn_time_ms_t now)
+{
+  ndn_face_measure_t* measure;
+  (void)measurements;
+
+  if(face_id == NDN_INVALID_ID || entry->send_time == 0 ||
+     !faceset_test(&entry->outgoing_faces, face_id)){
+    return;
+  }
+  measure = &measures[face_id];
+  ndn_measurements_estimate_rtt(&measure->srtt, &measure->rttvar, (uint32_t)(now - entry->send_time));
+}
+
+bool
+ndn_strategy_failover(ndn_face_measure_t* measures,
+                      ndn_measurements_t* measurements,
+                      ndn_pit_entry_t* entry,
+                      ndn_table_id_t face_id,
+                      uint32_t reason,
+                      ndn_time_ms_t now)
+{
+  (void)measures;
+  (void)measurements;
+  (void)entry;
+  (void)face_id;
+  (void)reason;
+  (void)now;
+  return true;
+}
+
+static ndn_faceset_t
+strategy_multicast_on_interest(ndn_face_measure_t* measures,
+                               ndn_measurements_t* measurements,
+                               ndn_pit_entry_t* entry,
+                               const ndn_faceset_t* candidates)
+{
+  (void)measures;
+  (void)measurements;
+  (void)entry;
+  return *candidates;
+}
+
+static ndn_faceset_t
+strategy_best_route_on_interest(ndn_face_measure_t* measures,
+                                ndn_measurements_t* measurements,
+                                ndn_pit_entry_t* entry,
+                                const ndn_faceset_t* candidates)
+{
+  ndn_faceset_t rest = *candidates, ret;
+  ndn_table_id_t id, best = NDN_INVALID_ID;
+  (void)measurements;
+  (void)entry;
+
+  while(!faceset_empty(&rest)){
+    id = faceset_pop_least(&rest);
+    if(best == NDN_INVALID_ID || measures[id].cost < measures[best].cost ||
+       (measures[id].cost == measures[best].cost && measures[id].srtt < measures[best].srtt)){
+      best = id;
+    }
+  }
+  faceset_clear(&ret);
+  faceset_set(&ret, best);
+  return ret;
+}
+
+static ndn_faceset_t
+strategy_load_balance_on_interest(ndn_face_measure_t* measures,
+                                  ndn_measurements_t* measurements,
+                                  ndn_pit_entry_t* entry,
+                                  const ndn_faceset_t* candidates)
+{
+  ndn_faceset_t rest = *candidates, ret;
+  ndn_table_id_t id, best = NDN_INVALID_ID;
+  int32_t total = 0;
+  (void)measurements;
+  (void)entry;
+
+  // Smooth weighted round-robin: every candidate earns its weight,
+  // and the richest one pays the total for sending the Interest
+  while(!faceset_empty(&rest)){
+    id = faceset_pop_least(&rest);
+    if(measures[id].weight == 0){
+      continue;
+    }
+    measures[id].credit += measures[id].weight;
+    total += measures[id].weight;
+    if(best == NDN_INVALID_ID || measures[id].credit > measures[best].credit){
+      best = id;
+    }
+  }
+  faceset_clear(&ret);
+  if(best != NDN_INVALID_ID){
+    measures[best].credit -= total;
+    faceset_set(&ret, best);
+  }
+  return ret;
+}
+
+// The timeout of a face under the prefix of the Interest, or of the face if unmeasured there
+static uint32_t
+strategy_adaptive_rto(ndn_face_measure_t* measures,
+                      ndn_measurements_t* measurements,
+                      const ndn_pit_entry_t* entry,
+                      ndn_table_id_t face_id)
+{
+  ndn_measurements_entry_t* prefix = NULL;
+
+  if(measurements != NULL){
+    prefix = ndn_measurements_find(measurements, entry->route_id, face_id);
+  }
+  if(prefix != NULL && prefix->srtt != 0){
+    return strategy_rto(prefix->srtt, prefix->rttvar);
+  }
+  return strategy_rto(measures[face_id].srtt, measures[face_id].rttvar);
+}
+
+static ndn_faceset_t
+strategy_adaptive_on_interest(ndn_face_measure_t* measures,
+                              ndn_measurements_t* measurements,
+                              ndn_pit_entry_t* entry,
+                              const ndn_faceset_t* candidates)
+{
+  ndn_faceset_t rest = *candidates, ret;
+  ndn_table_id_t id, best = NDN_INVALID_ID;
+  uint32_t rto, best_rto = 0;
+
+  // An unmeasured face has RTO 0, so it is probed before the others
+  while(!faceset_empty(&rest)){
+    id = faceset_pop_least(&rest);
+    rto = strategy_adaptive_rto(measures, measurements, entry, id);
+    if(best == NDN_INVALID_ID || rto < best_rto){
+      best = id;
+      best_rto = rto;
+    }
+  }
+  faceset_clear(&ret);
+  faceset_set(&ret, best);
+  return ret;
+}
+
+static void
+strategy_adaptive_penalize(uint32_t* srtt, uint32_t* rttvar, const ndn_pit_entry_t* entry)
+{
+  if(*srtt == 0){
+    *srtt = entry->options.lifetime;
+  }else if(strategy_rto(*srtt, *rttvar) < STRATEGY_MAX_RTO){
+    *srtt *= 2;
+    *rttvar *= 2;
+  }
+}
+
+// Penalize a face both as a whole and under the prefix of the Interest
+static void
+strategy_adaptive_penalize_face(ndn_face_measure_t* measures,
+                                ndn_measurements_t* measurements,
+                                const ndn_pit_entry_t* entry,
+                                ndn_table_id_t face_id)
+{
+  ndn_measurements_entry_t* prefix = NULL;
+
+  strategy_adaptive_penalize(&measures[face_id].srtt, &measures[face_id].rttvar, entry);
+  if(measurements != NULL){
+    prefix = ndn_measurements_find(measurements, entry->route_id, face_id);
+  }
+  if(prefix != NULL){
+    strategy_adaptive_penalize(&prefix->srtt, &prefix->rttvar, entry);
+  }
+}
+
+static void
+strategy_adaptive_on_timeout(ndn_face_measure_t* measures,
+                             ndn_measurements_t* measurements,
+                             ndn_pit_entry_t* entry,
+                             ndn_time_ms_t now)
+{
+  ndn_faceset_t faces = entry->outgoing_faces;
+  (void)now;
+
+  // Nacked faces have been penalized already
+  faceset_minus(&faces, &entry->nacked_faces);
+  while(!faceset_empty(&faces)){
+    strategy_adaptive_penalize_face(measures, measurements, entry, faceset_pop_least(&faces));
+  }
+}
+
+static bool
+strategy_adaptive_on_nack(ndn_face_measure_t* measures,
+                          ndn_measurements_t* measurements,
+                          ndn_pit_entry_t* entry,
+                          ndn_table_id_t face_id,
+                          uint32_t reason,
+                          ndn_time_ms_t now)
+{
+  (void)reason;
+  (void)now;
+  strategy_adaptive_penalize_face(measures, measurements, entry, face_id);
+  return true;
+}
+
+const ndn_strategy_t ndn_strategy_multicast = {
+  .on_interest = strategy_multicast_on_interest,
+  .on_data = NULL,
+  .on_timeout = NULL,
+  .on_nack = NULL,
+};
+
+const ndn_strategy_t ndn_strategy_best_route = {
+  .on_interest = strategy_best_route_on_interest,
+  .on_data = ndn_strategy_measure_rtt,
+  .on_timeout = NULL,
+  .on_nack = ndn_strategy_failover,
+};
+
+const ndn_strategy_t ndn_strategy_load_balance = {
+  .on_interest = strategy_load_balance_on_interest,
+  .on_data = ndn_strategy_measure_rtt,
+  .on_timeout = NULL,
+  .on_nack = ndn_strategy_failover,
+};
+
+const ndn_strategy_t ndn_strategy_adaptive = {
+  .on_interest = strategy_adaptive_on_interest,
+  .on_data = ndn_strategy_measure_rtt,
+  .on_timeout = strategy_adaptive_on_timeout,
+  .on_nack = strategy_adaptive_on_nack,
+};
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef FORWARDER_STRATEGY_H_
+#define FORWARDER_STRATEGY_H_
+
+#include "face-table.h"
+#include "pit.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup NDNFwdStrategy Strategy
+ * @brief Forwarding strategies.
+ *
+ * A strategy decides which next hops of a FIB entry an Interest goes to.
+ * It is set per FIB entry with ndn_fwd_set_strategy(); entries without one multicast.
+ * Strategies keep their state in the ndn_face_measure of each face, and may read
+ * the Measurements entries of the prefix an Interest is sent under.
+ * @ingroup NDNFwd
+ * @{
+ */
+
+/** Choose the next hops of an Interest.
+ * @param[in, out] measures Measurements of all faces, indexed by face ID.
+ * @param[in, out] measurements Measurements Table, keyed by ndn_pit_entry#route_id.
+ *                              @c NULL if the forwarder keeps none.
+ * @param[in] entry The PIT entry of the Interest.
+ * @param[in] candidates The next hops which are up and have not got the Interest yet.
+ *                       Never empty.
+ * @return The faces to send the Interest to, a subset of @c candidates.
+ */
+typedef ndn_faceset_t (*ndn_strategy_on_interest_func)(ndn_face_measure_t* measures,
+                                                       ndn_measurements_t* measurements,
+                                                       ndn_pit_entry_t* entry,
+                                                       const ndn_faceset_t* candidates);
+
+/** Data is received for an Interest sent by the strategy.
+ * @param[in, out] measures Measurements of all faces, indexed by face ID.
+ * @param[in, out] measurements Measurements Table, keyed by ndn_pit_entry#route_id.
+ *                              @c NULL if the forwarder keeps none.
+ * @param[in] entry The PIT entry of the Interest, removed after the call.
+ * @param[in] face_id The face the Data came from. #NDN_INVALID_ID if produced locally.
+ * @param[in] now The current time.
+ */
+typedef void (*ndn_strategy_on_data_func)(ndn_face_measure_t* measures,
+                                          ndn_measurements_t* measurements,
+                                          ndn_pit_entry_t* entry,
+                                          ndn_table_id_t face_id,
+                                          ndn_time_ms_t now);
+
+/** An Interest sent by the strategy timed out.
+ * @param[in, out] measures Measurements of all faces, indexed by face ID.
+ * @param[in, out] measurements Measurements Table, keyed by ndn_pit_entry#route_id.
+ *                              @c NULL if the forwarder keeps none.
+ * @param[in] entry The PIT entry of the Interest, removed after the call.
+ * @param[in] now The current time.
+ */
+typedef void (*ndn_strategy_on_timeout_func)(ndn_face_measure_t* measures,
+                                             ndn_measurements_t* measurements,
+                                             ndn_pit_entry_t* entry,
+                                             ndn_time_ms_t now);
+
+/** A next hop returned a Nack for an Interest sent by the strategy.
+ * @param[in, out] measures Measurements of all faces, indexed by face ID.
+ * @param[in, out] measurements Measurements Table, keyed by ndn_pit_entry#route_id.
+ *                              @c NULL if the forwarder keeps none.
+ * @param[in] entry The PIT entry of the Interest.
+ *                  The face is already in ndn_pit_entry#nacked_faces.
+ * @param[in] face_id The face the Nack came from.
+ * @param[in] reason The Nack reason.
+ * @param[in] now The current time.
+ * @return Whether to send the Interest to other next hops at once.
+ *         If so, ndn_strategy#on_interest is called with the next hops not tried yet.
+ */
+typedef bool (*ndn_strategy_on_nack_func)(ndn_face_measure_t* measures,
+                                          ndn_measurements_t* measurements,
+                                          ndn_pit_entry_t* entry,
+                                          ndn_table_id_t face_id,
+                                          uint32_t reason,
+                                          ndn_time_ms_t now);
+
+/** Forwarding strategy.
+ */
+typedef struct ndn_strategy {
+  /** Choose the next hops of an Interest.
+   */
+  ndn_strategy_on_interest_func on_interest;
+
+  /** [Optional] Data is received.
+   */
+  ndn_strategy_on_data_func on_data;
+
+  /** [Optional] An Interest timed out.
+   */
+  ndn_strategy_on_timeout_func on_timeout;
+
+  /** [Optional] A next hop returned a Nack.
+   * Without it, the Interest waits for other next hops.
+   */
+  ndn_strategy_on_nack_func on_nack;
+} ndn_strategy_t;
+
+/** Send Interests to all next hops.
+ */
+extern const ndn_strategy_t ndn_strategy_multicast;
+
+/** Send Interests to the next hop with the lowest ndn_face_measure#cost.
+ *
+ * Ties are broken by the lowest smoothed RTT.
+ * A retransmitted or Nacked Interest goes to the best next hop not tried yet.
+ * Once all have been tried, a retransmission goes to the best one again.
+ */
+extern const ndn_strategy_t ndn_strategy_best_route;
+
+/** Spread Interests over next hops in proportion to ndn_face_measure#weight.
+ *
+ * Uses smooth weighted round-robin. A Nacked Interest goes to another next hop.
+ */
+extern const ndn_strategy_t ndn_strategy_load_balance;
+
+/** Send Interests to the next hop with the lowest expected RTT.
+ *
+ * Faces are ranked by their retransmission timeout, <tt>srtt + 4 * rttvar</tt>,
+ * taken from the Measurements entry of the prefix if it has an RTT, or else from
+ * the ndn_face_measure of the face.
+ * Unmeasured faces are probed first, and the timeout of a face which fails to
+ * bring Data back or returns a Nack is doubled. A Nacked Interest goes to another next hop.
+ */
+extern const ndn_strategy_t ndn_strategy_adaptive;
+
+/** Update the RTT of the face which brought Data back.
+ *
+ * The common ndn_strategy#on_data of built-in strategies.
+ * Follows RFC 6298, measuring from the last time the Interest was sent out.
+ * Nothing is measured if @c face_id did not get the Interest.
+ */
+void
+ndn_strategy_measure_rtt(ndn_face_measure_t* measures,
+                         ndn_measurements_t* measurements,
+                         ndn_pit_entry_t* entry,
+                         ndn_table_id_t face_id,
+                         ndn_time_ms_t now);
+
+/** Try another next hop after a Nack.
+ *
+ * The common ndn_strategy#on_nack of built-in strategies which pick one next hop.
+ */
+bool
+ndn_strategy_failover(ndn_face_measure_t* measures,
+                      ndn_measurements_t* measurements,
+                      ndn_pit_entry_t* entry,
+                      ndn_table_id_t face_id,
+                      uint32_t reason,
+                      ndn_time_ms_t now);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FORWARDER_STRATEGY_H_
@@ -36,17 +36,37 @@
 #define NDN_SIGNATURE_BUFFER_SIZE 128
 
 // forwarder
+#ifdef NDN_FORWARDER_LARGE_TABLES
+// Table sizes above 65534, e.g. for a gateway using ndn_forwarder_init_with_config
+typedef uint32_t ndn_table_id_t;
+
+#define NDN_INVALID_ID 0xFFFFFFFF
+#else
 typedef uint16_t ndn_table_id_t;
 
 #define NDN_INVALID_ID 0xFFFF
+#endif
 #define NDN_NAMETREE_MAX_SIZE 64
 #define NDN_FIB_MAX_SIZE 20
 #define NDN_PIT_MAX_SIZE 32
 #define NDN_CS_MAX_SIZE 10
+#define NDN_CS_DATA_BUFFER_SIZE 512
 #define NDN_FACE_TABLE_MAX_SIZE 10
+#define NDN_DEAD_NONCE_LIST_SIZE 64 // A power of 2
+#define NDN_DEAD_NONCE_LIFETIME 6000 // ms
+#define NDN_RETX_SUPPRESSION_INITIAL 10 // ms
+#define NDN_RETX_SUPPRESSION_MAX 250 // ms
+#ifndef NDN_FACESET_WORDS
+// 64-bit words of a face set, i.e. a FIB or PIT entry can refer to 64 * NDN_FACESET_WORDS faces
+#define NDN_FACESET_WORDS 1
+#endif
 #define NDN_FACE_DEFAULT_COST 1
 #define NDN_AES_BLOCK_SIZE 16
 #define NDN_MAX_FACE_PER_PIT_ENTRY 3
+#define NDN_FORWARDER_POOL_MAX_SHARDS 16
+#define NDN_FORWARDER_BATCH_SIZE 32
+#define NDN_FORWARDER_NACK_SIZE 512 // Longer Interests are dropped without a Nack
+#define NDN_FORWARDER_MAX_COMPONENTS 32 // Packets with longer names are dropped
 
 // fragmentation support
 #define NDN_FRAG_HDR_LEN 3 // Size of the NDN L2 fragmentation header
@@ -29,6 +29,14 @@ enum {
   NDN_FWD_STRATEGY_MULTICAST = 1,
 };
 
+// NDNLPv2 Nack reasons, from the least severe to the most severe
+enum {
+  NDN_NACK_REASON_NONE = 0,
+  NDN_NACK_REASON_CONGESTION = 50,
+  NDN_NACK_REASON_DUPLICATE = 100,
+  NDN_NACK_REASON_NO_ROUTE = 150,
+};
+
 // content type values
 enum {
   NDN_CONTENT_TYPE_BLOB = 0,
@@ -151,6 +151,18 @@
 /** The message queue is full.
  */
 #define NDN_FWD_MSGQUEUE_FULL -57
+
+/** Failed to allocate memory for the forwarder tables.
+ */
+#define NDN_FWD_NO_MEMORY -58
+
+/** The ingress ring is full. The packet is dropped.
+ */
+#define NDN_FWD_INGRESS_FULL -59
+
+/** A route batch posted earlier has not been taken by the forwarder yet.
+ */
+#define NDN_FWD_ROUTE_BATCH_BUSY -63
 /* @} */
 
 /** @defgroup NDNErrorCodeFace Face Errors
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+#ifndef UTIL_ATOMIC_H_
+#define UTIL_ATOMIC_H_
+
+/** @file
+ * Atomic members of public structures.
+ *
+ * C11 atomics are not part of C++, so a C++ program including a public header
+ * sees an atomic member as its plain type, with the same size and alignment.
+ * Atomic members are only accessed by the C sources of the library.
+ */
+
+#ifndef __cplusplus
+
+#include <stdatomic.h>
+
+#define NDN_ATOMIC(type) _Atomic(type)
+
+#else
+
+#define NDN_ATOMIC(type) type
+
+#endif
+
+#endif // UTIL_ATOMIC_H_
@@ -8,8 +8,10 @@
 #ifndef UTIL_BIT_OPERATIONS_H_
 #define UTIL_BIT_OPERATIONS_H_
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include "../ndn-constants.h"
 
 typedef uint64_t ndn_bitset_t;
 
@@ -24,7 +26,7 @@ static inline ndn_bitset_t bitset_unset(ndn_bitset_t set, size_t val){
 }
 
 static inline size_t bitset_log2(ndn_bitset_t val){
-  return __builtin_ctz(val);
+  return __builtin_ctzll(val);
 }
 
 static inline size_t bitset_pop_least(ndn_bitset_t* val){
@@ -34,4 +36,68 @@ static inline size_t bitset_pop_least(ndn_bitset_t* val){
   return ret;
 }
 
+/** A set of face IDs, #NDN_FACESET_WORDS words wide.
+ *
+ * With one word, the operations compile to the same code as a plain #ndn_bitset_t.
+ */
+typedef struct ndn_faceset {
+  ndn_bitset_t words[NDN_FACESET_WORDS];
+} ndn_faceset_t;
+
+/** The number of face IDs a #ndn_faceset_t can hold.
+ */
+#define NDN_FACESET_CAPACITY (NDN_FACESET_WORDS * sizeof(ndn_bitset_t) * 8)
+
+#define FACESET_WORD(id) ((id) / (sizeof(ndn_bitset_t) * 8))
+#define FACESET_BIT(id) ((id) % (sizeof(ndn_bitset_t) * 8))
+
+static inline void faceset_clear(ndn_faceset_t* set){
+  for(size_t i = 0; i < NDN_FACESET_WORDS; i ++)
+    set->words[i] = 0;
+}
+
+static inline void faceset_set(ndn_faceset_t* set, size_t id){
+  set->words[FACESET_WORD(id)] = bitset_set(set->words[FACESET_WORD(id)], FACESET_BIT(id));
+}
+
+static inline void faceset_unset(ndn_faceset_t* set, size_t id){
+  set->words[FACESET_WORD(id)] = bitset_unset(set->words[FACESET_WORD(id)], FACESET_BIT(id));
+}
+
+static inline bool faceset_test(const ndn_faceset_t* set, size_t id){
+  return (set->words[FACESET_WORD(id)] >> FACESET_BIT(id)) & 1;
+}
+
+static inline bool faceset_empty(const ndn_faceset_t* set){
+  for(size_t i = 0; i < NDN_FACESET_WORDS; i ++){
+    if(set->words[i] != 0)
+      return false;
+  }
+  return true;
+}
+
+/** <tt>*set |= *other</tt>
+ */
+static inline void faceset_union(ndn_faceset_t* set, const ndn_faceset_t* other){
+  for(size_t i = 0; i < NDN_FACESET_WORDS; i ++)
+    set->words[i] |= other->words[i];
+}
+
+/** <tt>*set &= ~*other</tt>
+ */
+static inline void faceset_minus(ndn_faceset_t* set, const ndn_faceset_t* other){
+  for(size_t i = 0; i < NDN_FACESET_WORDS; i ++)
+    set->words[i] &= ~other->words[i];
+}
+
+/** Remove and return the least ID.
+ * @pre @c set is not empty.
+ */
+static inline size_t faceset_pop_least(ndn_faceset_t* set){
+  size_t i = 0;
+  while(set->words[i] == 0)
+    i ++;
+  return i * sizeof(ndn_bitset_t) * 8 + bitset_pop_least(&set->words[i]);
+}
+
 #endif // UTIL_BIT_OPERATIONS_H_
\ No newline at end of file
@@ -33,105 +33,140 @@ typedef struct ndn_msg{
 } ndn_msg_t;
 #pragma pack()
 
-static uint8_t msg_queue[NDN_MSGQUEUE_SIZE];
-static ndn_msg_t *pfront, *ptail, *psplit;
+static ndn_msgqueue_t msg_queue;
 
-#define MSGQUEUE_NEXT(ptr) \
+#define MSGQUEUE_NEXT(self, ptr) \
   ptr = (ndn_msg_t*)(((uint8_t*)ptr) + ptr->length); \
-  if(((uint8_t*)ptr) >= &msg_queue[NDN_MSGQUEUE_SIZE]){ \
-    ptr = (ndn_msg_t*)&msg_queue[0]; \
+  if(((uint8_t*)ptr) >= &(self)->memory[NDN_MSGQUEUE_SIZE]){ \
+    ptr = (ndn_msg_t*)&(self)->memory[0]; \
   };
 
 
 void
-ndn_msgqueue_init(void) {
-  pfront = ptail = psplit = (ndn_msg_t*)&msg_queue;
+ndn_msgq_init(ndn_msgqueue_t* self) {
+  self->pfront = self->ptail = self->psplit = (ndn_msg_t*)&self->memory[0];
 }
 
 bool
-ndn_msgqueue_empty(void) {
-  while(pfront->func == NDN_MSG_PADDING && pfront != ptail){
-    MSGQUEUE_NEXT(pfront);
+ndn_msgq_empty(ndn_msgqueue_t* self) {
+  while(self->pfront->func == NDN_MSG_PADDING && self->pfront != self->ptail){
+    MSGQUEUE_NEXT(self, self->pfront);
   }
-  if(pfront == ptail){
+  if(self->pfront == self->ptail){
     // defrag when empty
-    pfront = ptail = psplit = (ndn_msg_t*)&msg_queue[0];
+    self->pfront = self->ptail = self->psplit = (ndn_msg_t*)&self->memory[0];
     return true;
   } else
     return false;
 }
 
 bool
-ndn_msgqueue_dispatch(void) {
-  if(ndn_msgqueue_empty())
+ndn_msgq_dispatch(ndn_msgqueue_t* self) {
+  if(ndn_msgq_empty(self))
     return false;
 
-  pfront->func(pfront->obj, pfront->length - sizeof(ndn_msg_t), pfront->param);
-  MSGQUEUE_NEXT(pfront);
+  self->pfront->func(self->pfront->obj, self->pfront->length - sizeof(ndn_msg_t), self->pfront->param);
+  MSGQUEUE_NEXT(self, self->pfront);
   return true;
 }
 
 struct ndn_msg*
-ndn_msgqueue_post(void *target,
-                  ndn_msg_callback reason,
-                  size_t param_length,
-                  void *param)
+ndn_msgq_post(ndn_msgqueue_t* self,
+              void *target,
+              ndn_msg_callback reason,
+              size_t param_length,
+              void *param)
 {
+  uint8_t* queue = self->memory;
   size_t len = param_length + sizeof(ndn_msg_t);
   size_t space;
   ndn_msg_t* ret;
 
   // defrag the memory
-  ndn_msgqueue_empty();
+  ndn_msgq_empty(self);
 
-  if(pfront > ptail) {
+  if(self->pfront > self->ptail) {
     // -1 is to prevent (ptail == pfront) after call
-    space = ((uint8_t*)pfront) - ((uint8_t*)ptail) - 1;
+    space = ((uint8_t*)self->pfront) - ((uint8_t*)self->ptail) - 1;
   } else {
-    space = (&msg_queue[NDN_MSGQUEUE_SIZE] - ((uint8_t*)ptail));
+    space = (&queue[NDN_MSGQUEUE_SIZE] - ((uint8_t*)self->ptail));
   }
 
   // After tail?
-  if(pfront >= ptail || space >= len + sizeof(ndn_msg_t)){
+  if(self->pfront >= self->ptail || space >= len + sizeof(ndn_msg_t)){
     // No-padding (= is to prevent ptail == pfront after call)
-    if(space < len || (space == len && pfront == (ndn_msg_t*)&msg_queue))
+    if(space < len || (space == len && self->pfront == (ndn_msg_t*)queue))
       return NULL;
   } else {
     // Padding & rewind (= is to prevent ptail == pfront after call)
-    if(((uint8_t*)pfront) - &msg_queue[0] <= (int) len)
+    if(((uint8_t*)self->pfront) - &queue[0] <= (int) len)
       return NULL;
 
     if(space >= sizeof(ndn_msg_t)){
-      ptail->func = NDN_MSG_PADDING;
-      ptail->length = space;
-      ptail = (ndn_msg_t*)&msg_queue[0];
+      self->ptail->func = NDN_MSG_PADDING;
+      self->ptail->length = space;
+      self->ptail = (ndn_msg_t*)&queue[0];
     }else{
       // This should never happen
       return NULL;
     }
   }
 
-  ptail->obj = target;
-  ptail->func = reason;
-  ptail->length = len;
+  self->ptail->obj = target;
+  self->ptail->func = reason;
+  self->ptail->length = len;
   if(param_length > 0){
-    memcpy(ptail->param, param, param_length);
+    memcpy(self->ptail->param, param, param_length);
   }
 
-  ret = ptail;
-  MSGQUEUE_NEXT(ptail);
+  ret = self->ptail;
+  MSGQUEUE_NEXT(self, self->ptail);
 
   return ret;
 }
 
 void
-ndn_msgqueue_process(void) {
-  psplit = ptail;
-  while(pfront != psplit){
-    ndn_msgqueue_dispatch();
+ndn_msgq_process(ndn_msgqueue_t* self) {
+  self->psplit = self->ptail;
+  while(self->pfront != self->psplit){
+    ndn_msgq_dispatch(self);
   }
 }
 
+ndn_msgqueue_t*
+ndn_msgqueue_get_default(void) {
+  return &msg_queue;
+}
+
+void
+ndn_msgqueue_init(void) {
+  ndn_msgq_init(&msg_queue);
+}
+
+bool
+ndn_msgqueue_empty(void) {
+  return ndn_msgq_empty(&msg_queue);
+}
+
+bool
+ndn_msgqueue_dispatch(void) {
+  return ndn_msgq_dispatch(&msg_queue);
+}
+
+struct ndn_msg*
+ndn_msgqueue_post(void *target,
+                  ndn_msg_callback reason,
+                  size_t param_length,
+                  void *param)
+{
+  return ndn_msgq_post(&msg_queue, target, reason, param_length, param);
+}
+
+void
+ndn_msgqueue_process(void) {
+  ndn_msgq_process(&msg_queue);
+}
+
 void
 ndn_msgqueue_cancel(struct ndn_msg* msg){
   msg->func = NDN_MSG_PADDING;
@@ -35,6 +35,16 @@ extern "C" {
 struct ndn_msg;
 #pragma pack()
 
+/** A message queue.
+ *
+ * Each forwarder instance owns one, so instances never share mutable state.
+ * The functions without a queue parameter work on a default queue.
+ */
+typedef struct ndn_msgqueue {
+  uint8_t memory[NDN_MSGQUEUE_SIZE];
+  struct ndn_msg *pfront, *ptail, *psplit;
+} ndn_msgqueue_t;
+
 /** The callback function of message.
  * 
  * @param[in, out] self The object to receive this message.
@@ -50,6 +60,49 @@ typedef void(*ndn_msg_callback)(void *self,
 void
 ndn_msgqueue_init(void);
 
+/** Get the default queue, used by the functions without a queue parameter.
+ */
+ndn_msgqueue_t*
+ndn_msgqueue_get_default(void);
+
+/** Init a message queue.
+ * @param[out] self The queue to init.
+ */
+void
+ndn_msgq_init(ndn_msgqueue_t* self);
+
+/** Post a message to a queue.
+ * @param[in, out] self The queue.
+ * @sa ndn_msgqueue_post
+ */
+struct ndn_msg*
+ndn_msgq_post(ndn_msgqueue_t* self,
+              void *target,
+              ndn_msg_callback reason,
+              size_t param_length,
+              void *param);
+
+/** Dispatch a message on the top of a queue.
+ * @param[in, out] self The queue.
+ * @sa ndn_msgqueue_dispatch
+ */
+bool
+ndn_msgq_dispatch(ndn_msgqueue_t* self);
+
+/** Return if a message queue is empty.
+ * @param[in, out] self The queue.
+ * @sa ndn_msgqueue_empty
+ */
+bool
+ndn_msgq_empty(ndn_msgqueue_t* self);
+
+/** Dispatch current messages of a queue.
+ * @param[in, out] self The queue.
+ * @sa ndn_msgqueue_process
+ */
+void
+ndn_msgq_process(ndn_msgqueue_t* self);
+
 /** Post a message to the queue.
  * @param[in] target The object to receive this message.
  * @param[in] reason The message callback function.
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "pktbuf.h"
+#include <string.h>
+
+void
+ndn_pktbuf_pool_init(void* memory, size_t buf_size, size_t buf_count)
+{
+  ndn_pktbuf_pool_t* self = (ndn_pktbuf_pool_t*)memory;
+  self->buf_size = buf_size;
+  atomic_init(&self->returned, NULL);
+  ndn_memory_pool_init(self->blocks, NDN_PKTBUF_BLOCK_SIZE(buf_size), buf_count);
+}
+
+// Put the released buffers back into the memory pool, on the forwarder's thread
+static void
+pktbuf_pool_collect(ndn_pktbuf_pool_t* pool)
+{
+  ndn_pktbuf_t *buf, *next;
+
+  // Taking the whole list at once leaves no ABA problem to the producers
+  buf = atomic_exchange_explicit(&pool->returned, NULL, memory_order_acquire);
+  while(buf != NULL){
+    next = buf->next;
+    ndn_memory_pool_free(pool->blocks, buf);
+    buf = next;
+  }
+}
+
+ndn_pktbuf_t*
+ndn_pktbuf_new(ndn_pktbuf_pool_t* pool, const uint8_t* packet, size_t length)
+{
+  ndn_pktbuf_t* ret;
+
+  if(length > pool->buf_size)
+    return NULL;
+  ret = (ndn_pktbuf_t*)ndn_memory_pool_alloc(pool->blocks);
+  if(ret == NULL){
+    pktbuf_pool_collect(pool);
+    ret = (ndn_pktbuf_t*)ndn_memory_pool_alloc(pool->blocks);
+    if(ret == NULL)
+      return NULL;
+  }
+  ret->pool = pool;
+  atomic_store_explicit(&ret->ref_cnt, 1, memory_order_relaxed);
+  ret->length = length;
+  memcpy(ret->data, packet, length);
+  return ret;
+}
+
+ndn_pktbuf_t*
+ndn_pktbuf_ref(ndn_pktbuf_t* self)
+{
+  atomic_fetch_add_explicit(&self->ref_cnt, 1, memory_order_relaxed);
+  return self;
+}
+
+void
+ndn_pktbuf_unref(ndn_pktbuf_t* self)
+{
+  ndn_pktbuf_pool_t* pool = self->pool;
+  ndn_pktbuf_t* head;
+
+  // acq_rel: the last owner sees every other owner done with the data
+  if(atomic_fetch_sub_explicit(&self->ref_cnt, 1, memory_order_acq_rel) != 1)
+    return;
+  head = atomic_load_explicit(&pool->returned, memory_order_relaxed);
+  do{
+    self->next = head;
+  }while(!atomic_compare_exchange_weak_explicit(&pool->returned, &head, self,
+                                                memory_order_release, memory_order_relaxed));
+}
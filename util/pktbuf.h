@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2019 Xinyu Ma
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3.0. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef UTIL_PKTBUF_H_
+#define UTIL_PKTBUF_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "atomic.h"
+#include "memory-pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup NDNUtilPktBuf Packet Buffer
+ * @ingroup NDNUtil
+ *
+ * Reference counted packet buffers allocated from a memory pool.
+ * A face keeps a reference to send a packet later instead of copying it.
+ * References may be taken and dropped on any thread.
+ * A buffer whose last reference is dropped goes to a lock-free return list,
+ * and is put back into the memory pool by ndn_pktbuf_new() on the forwarder's thread.
+ * @{
+ */
+
+struct ndn_pktbuf_pool;
+
+/**
+ * A packet buffer.
+ */
+typedef struct ndn_pktbuf {
+  /** The pool owning this buffer.
+   */
+  struct ndn_pktbuf_pool* pool;
+
+  /** Number of references. The buffer goes back to @c pool when it drops to 0.
+   */
+  NDN_ATOMIC(unsigned int) ref_cnt;
+
+  /** The next buffer in the return list of @c pool.
+   */
+  struct ndn_pktbuf* next;
+
+  /** The length of @c data.
+   */
+  uint32_t length;
+
+  uint8_t data[];
+} ndn_pktbuf_t;
+
+/**
+ * A pool of packet buffers.
+ */
+typedef struct ndn_pktbuf_pool {
+  /** Maximum size of a packet.
+   */
+  size_t buf_size;
+
+  /** Buffers released by any thread, not yet back in @c blocks.
+   */
+  NDN_ATOMIC(struct ndn_pktbuf*) returned;
+
+  /** The memory pool of buffers. Only used on the forwarder's thread.
+   */
+  void* blocks[];
+} ndn_pktbuf_pool_t;
+
+/** The block size of a buffer, rounded up so that the next buffer is aligned to a pointer.
+ */
+#define NDN_PKTBUF_BLOCK_SIZE(buf_size) \
+  ((sizeof(ndn_pktbuf_t) + (buf_size) + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*))
+
+/** The memory reserved for a pool.
+ * @param[in] buf_size Maximum size of a packet.
+ * @param[in] buf_count Number of buffers.
+ */
+#define NDN_PKTBUF_POOL_RESERVE_SIZE(buf_size, buf_count) \
+  (sizeof(ndn_pktbuf_pool_t) + \
+   NDN_MEMORY_POOL_RESERVE_SIZE(NDN_PKTBUF_BLOCK_SIZE(buf_size), buf_count))
+
+/** Initialize a pool at specified memory space.
+ * @param[in, out] memory Memory in size of #NDN_PKTBUF_POOL_RESERVE_SIZE, aligned to a pointer.
+ * @param[in] buf_size Maximum size of a packet.
+ * @param[in] buf_count Number of buffers.
+ */
+void
+ndn_pktbuf_pool_init(void* memory, size_t buf_size, size_t buf_count);
+
+/** Copy a packet into a new buffer.
+ *
+ * Only called on the forwarder's thread.
+ * @param[in, out] pool The pool.
+ * @param[in] packet The packet.
+ * @param[in] length The length of @c packet.
+ * @return The buffer, holding one reference. @c NULL if @c pool is empty or @c packet is too large.
+ */
+ndn_pktbuf_t*
+ndn_pktbuf_new(ndn_pktbuf_pool_t* pool, const uint8_t* packet, size_t length);
+
+/** Take a reference to a buffer. Safe to call from any thread.
+ * @param[in, out] self The buffer.
+ * @return @c self.
+ */
+ndn_pktbuf_t*
+ndn_pktbuf_ref(ndn_pktbuf_t* self);
+
+/** Drop a reference to a buffer, releasing it with the last one. Safe to call from any thread.
+ * @param[in, out] self The buffer.
+ */
+void
+ndn_pktbuf_unref(ndn_pktbuf_t* self);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UTIL_PKTBUF_H_